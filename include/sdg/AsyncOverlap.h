@@ -0,0 +1,139 @@
+#pragma once
+
+#include <functional>
+#include <limits>
+#include <queue>
+
+#include "DependencyGraph.h"
+
+// Which passes could run at the same time, to decide what to move to async compute or other CPU lanes
+struct TAsyncOverlap {
+
+    // Passes that are neither ancestors nor descendants of 'pass', sorted by id
+    static std::vector<size_t> concurrentWith(const TCompiledGraph& graph, const size_t pass) {
+        std::vector<bool> ordered(graph.size(), false);
+        ordered[pass] = true;
+
+        std::vector<size_t> stack{pass};
+        while (!stack.empty()) {
+            const size_t node = stack.back();
+            stack.pop_back();
+            for (size_t successor : graph.successors(node))
+                if (!ordered[successor]) {
+                    ordered[successor] = true;
+                    stack.push_back(successor);
+                }
+        }
+
+        stack.push_back(pass);
+        while (!stack.empty()) {
+            const size_t node = stack.back();
+            stack.pop_back();
+            for (size_t predecessor : graph.predecessors(node))
+                if (!ordered[predecessor]) {
+                    ordered[predecessor] = true;
+                    stack.push_back(predecessor);
+                }
+        }
+
+        std::vector<size_t> concurrent;
+        for (size_t node = 0; node < graph.size(); ++node)
+            if (!ordered[node] && !graph.isRemoved(node))
+                concurrent.push_back(node);
+        return concurrent;
+    }
+
+    struct Lanes {
+        // Lane and start time of each pass, SIZE_MAX and 0 for removed passes
+        std::vector<size_t> laneOf;
+        std::vector<double> start;
+        // Passes of each lane in the order they run
+        std::vector<std::vector<size_t>> lanes;
+        // When the last pass finishes
+        double makespan = 0.0;
+    };
+
+    // Greedy list scheduling, whenever a lane is free it runs the ready pass with the longest way to the end of the graph
+    // Lower lanes are filled first, so the critical path mostly stays on lane 0 and what can overlap it spreads over the other lanes
+    // 'costs' is the duration of each pass, every pass takes 1 if it is empty
+    static Lanes assignLanes(const TCompiledGraph& graph, const size_t laneCount, const std::vector<double>& costs = {}) {
+        if (laneCount == 0)
+            throw std::invalid_argument("At least one lane is needed!");
+
+        const auto costOf = [&](const size_t node) { return costs.empty() ? 1.0 : costs[node]; };
+        const std::vector<size_t> order = TKahnTopologicalSort{}(graph);
+
+        // Longest way from the start of each pass to the end of the graph
+        std::vector<double> priority(graph.size(), 0.0);
+        for (auto node = order.rbegin(); node != order.rend(); ++node) {
+            double longest = 0.0;
+            for (size_t successor : graph.successors(*node))
+                longest = std::max(longest, priority[successor]);
+            priority[*node] = costOf(*node) + longest;
+        }
+
+        Lanes result;
+        result.laneOf.assign(graph.size(), SIZE_MAX);
+        result.start.assign(graph.size(), 0.0);
+        result.lanes.resize(laneCount);
+
+        const auto later = [&](const size_t a, const size_t b) {
+            return priority[a] != priority[b] ? priority[a] < priority[b] : a > b;
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(later)> ready(later);
+        // Passes whose predecessors are all scheduled, by the time the last of them finishes
+        std::priority_queue<std::pair<double, size_t>, std::vector<std::pair<double, size_t>>, std::greater<>> waiting;
+        std::vector<size_t> inDegree(graph.inDegree.begin(), graph.inDegree.end());
+        std::vector<double> readyAt(graph.size(), 0.0);
+        std::vector<double> laneFree(laneCount, 0.0);
+        for (size_t node = 0; node < graph.size(); ++node)
+            if (inDegree[node] == 0 && !graph.isRemoved(node))
+                waiting.emplace(0.0, node);
+
+        // Whenever a lane is free, it takes the most urgent pass that is ready by then
+        double time = 0.0;
+        size_t remaining = order.size();
+        while (remaining > 0) {
+            bool scheduled = true;
+            while (scheduled) {
+                scheduled = false;
+                while (!waiting.empty() && waiting.top().first <= time) {
+                    ready.push(waiting.top().second);
+                    waiting.pop();
+                }
+
+                for (size_t lane = 0; lane < laneCount && !ready.empty(); ++lane) {
+                    if (laneFree[lane] > time)
+                        continue;
+
+                    const size_t node = ready.top();
+                    ready.pop();
+                    const double finish = time + costOf(node);
+                    laneFree[lane] = finish;
+                    result.laneOf[node] = lane;
+                    result.start[node] = time;
+                    result.lanes[lane].push_back(node);
+                    result.makespan = std::max(result.makespan, finish);
+                    --remaining;
+                    scheduled = true;
+
+                    for (size_t successor : graph.successors(node)) {
+                        readyAt[successor] = std::max(readyAt[successor], finish);
+                        if (--inDegree[successor] == 0)
+                            waiting.emplace(readyAt[successor], successor);
+                    }
+                }
+            }
+
+            double next = waiting.empty() ? std::numeric_limits<double>::max() : waiting.top().first;
+            for (double free : laneFree)
+                if (free > time)
+                    next = std::min(next, free);
+            if (next == std::numeric_limits<double>::max())
+                break;
+            time = next;
+        }
+
+        return result;
+    }
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+
+#include "DependencyGraph.h"
+
+// Read only form of a compiled graph for very large graphs, sorters iterate it directly
+// Only successors are kept, decompress it for predecessor queries
+// Each node's sorted successors are stored as gaps in LEB128 varints, the first one relative to the node itself,
+// so graphs renumbered into execution order mostly need a single byte per edge instead of eight
+struct TCompressedGraph {
+
+    struct Iterator {
+        const uint8_t* cursor = nullptr;
+        const uint8_t* last = nullptr;
+        size_t value = 0;
+        bool valid = false;
+
+        size_t operator*() const { return value; }
+
+        Iterator& operator++() {
+            if (cursor == last)
+                valid = false;
+            else
+                value += decode(cursor) + 1;
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return valid == other.valid && (!valid || cursor == other.cursor);
+        }
+
+        bool operator!=(const Iterator& other) const { return !(*this == other); }
+    };
+
+    struct Range {
+        const uint8_t* first = nullptr;
+        const uint8_t* last = nullptr;
+        size_t node = 0;
+
+        Iterator begin() const {
+            Iterator it{first, last, 0, first != last};
+            if (it.valid) {
+                // Zigzag, as the first successor may have a lower id than the node
+                const uint64_t zigzag = decode(it.cursor);
+                it.value = static_cast<size_t>(static_cast<int64_t>(node) + static_cast<int64_t>((zigzag >> 1) ^ (~(zigzag & 1) + 1)));
+            }
+            return it;
+        }
+
+        Iterator end() const { return Iterator{}; }
+        bool empty() const { return first == last; }
+    };
+
+    static TCompressedGraph compress(const TCompiledGraph& graph) {
+        TCompressedGraph result;
+        result.offsets.reserve(graph.size() + 1);
+        result.offsets.push_back(0);
+        result.inDegree.assign(graph.inDegree.begin(), graph.inDegree.end());
+        result.removed = graph.removed;
+        result.removedCount = graph.removedCount;
+        result.edges = graph.edgeCount();
+
+        for (size_t node = 0; node < graph.size(); ++node) {
+            size_t previous = node;
+            bool first = true;
+            for (size_t to : graph.successors(node)) {
+                if (first) {
+                    const int64_t delta = static_cast<int64_t>(to) - static_cast<int64_t>(node);
+                    encode(result.bytes, (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63));
+                    first = false;
+                } else {
+                    // Successors are sorted and unique, so every gap is at least 1
+                    encode(result.bytes, to - previous - 1);
+                }
+                previous = to;
+            }
+            result.offsets.push_back(result.bytes.size());
+        }
+
+        result.bytes.shrink_to_fit();
+        return result;
+    }
+
+    TCompiledGraph decompress() const {
+        TCompiledGraph graph;
+        graph.offsets.reserve(size() + 1);
+        graph.offsets.push_back(0);
+        graph.targets.reserve(edges);
+        for (size_t node = 0; node < size(); ++node) {
+            for (size_t to : successors(node))
+                graph.targets.push_back(to);
+            graph.offsets.push_back(graph.targets.size());
+        }
+        graph.inDegree.assign(inDegree.begin(), inDegree.end());
+        graph.removed = removed;
+        graph.removedCount = removedCount;
+        graph.buildPredecessors();
+        return graph;
+    }
+
+    size_t size() const { return inDegree.size(); }
+    size_t edgeCount() const { return edges; }
+    bool isRemoved(const size_t node) const { return removedCount > 0 && removed[node]; }
+
+    Range successors(const size_t node) const {
+        return Range{bytes.data() + offsets[node], bytes.data() + offsets[node + 1], node};
+    }
+
+    // Total heap memory used by the graph
+    size_t memoryUsage() const {
+        return bytes.capacity() + offsets.capacity() * sizeof(size_t) + inDegree.capacity() * sizeof(uint32_t) + removed.capacity() / 8;
+    }
+
+    std::vector<uint8_t> bytes;
+    std::vector<size_t> offsets;
+    std::vector<uint32_t> inDegree;
+    std::vector<bool> removed;
+    size_t removedCount = 0;
+
+private:
+
+    static void encode(std::vector<uint8_t>& bytes, uint64_t value) {
+        while (value >= 0x80) {
+            bytes.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(value));
+    }
+
+    static uint64_t decode(const uint8_t*& cursor) {
+        uint64_t value = 0;
+        for (unsigned shift = 0; ; shift += 7) {
+            const uint8_t byte = *cursor++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+    }
+
+    size_t edges = 0;
+};
@@ -5,6 +5,281 @@
 #include <map>
 #include <unordered_set>
 #include <queue>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// Immutable CSR (compressed sparse row) form of a graph
+// The nodes that must run after node i are targets[offsets[i]] up to targets[offsets[i + 1]], sorted and without duplicates
+// The nodes that must run before it are stored the same way in predecessorOffsets and predecessorNodes
+struct TCompiledGraph {
+
+    struct Range {
+        const size_t* first = nullptr;
+        const size_t* last = nullptr;
+
+        const size_t* begin() const { return first; }
+        const size_t* end() const { return last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+        bool empty() const { return first == last; }
+    };
+
+    size_t size() const { return inDegree.size(); }
+    size_t edgeCount() const { return targets.size(); }
+
+    bool isRemoved(const size_t node) const { return removedCount > 0 && removed[node]; }
+
+    Range successors(const size_t node) const {
+        return Range{targets.data() + offsets[node], targets.data() + offsets[node + 1]};
+    }
+
+    Range predecessors(const size_t node) const {
+        return Range{predecessorNodes.data() + predecessorOffsets[node], predecessorNodes.data() + predecessorOffsets[node + 1]};
+    }
+
+    // Edges are (from, to) pairs, meaning 'to' must run after 'from'
+    static TCompiledGraph fromEdges(const size_t nodeCount, const std::vector<std::pair<size_t, size_t>>& edges) {
+        return build(nodeCount, edges.size(), [&](auto&& visit) {
+            for (const auto& [from, to] : edges)
+                visit(from, to);
+        });
+    }
+
+    // Same as fromEdges, for edges that were gathered in several lists, e.g. one per thread
+    static TCompiledGraph fromEdgeLists(const size_t nodeCount, const std::vector<const std::vector<std::pair<size_t, size_t>>*>& edgeLists) {
+        size_t edgeCount = 0;
+        for (const auto* edges : edgeLists)
+            edgeCount += edges->size();
+        return build(nodeCount, edgeCount, [&](auto&& visit) {
+            for (const auto* edges : edgeLists)
+                for (const auto& [from, to] : *edges)
+                    visit(from, to);
+        });
+    }
+
+    // Both lists have to be sorted and without duplicates, e.g. kept that way while a graph grows, so nothing is sorted here
+    // Lists may be shorter than 'nodeCount', missing nodes have no edges
+    static TCompiledGraph fromSortedLists(const size_t nodeCount, const std::vector<std::vector<size_t>>& successorLists, const std::vector<std::vector<size_t>>& predecessorLists) {
+        TCompiledGraph graph;
+        graph.assignSortedLists(nodeCount, successorLists, predecessorLists);
+        return graph;
+    }
+
+    // Same as fromSortedLists, but reuses the memory this graph already has
+    // Nodes before 'firstChanged' are kept as they are, so they have to hold the same lists already and no node may be removed
+    void assignSortedLists(const size_t nodeCount, const std::vector<std::vector<size_t>>& successorLists, const std::vector<std::vector<size_t>>& predecessorLists, size_t firstChanged = 0) {
+        if (removedCount > 0 || offsets.empty())
+            firstChanged = 0;
+        firstChanged = std::min(firstChanged, std::min(nodeCount, size()));
+
+        removed.clear();
+        removedCount = 0;
+        offsets.resize(nodeCount + 1);
+        predecessorOffsets.resize(nodeCount + 1);
+        inDegree.resize(nodeCount);
+        offsets[0] = 0;
+        predecessorOffsets[0] = 0;
+        for (size_t node = firstChanged; node < nodeCount; ++node) {
+            offsets[node + 1] = offsets[node] + (node < successorLists.size() ? successorLists[node].size() : 0);
+            inDegree[node] = node < predecessorLists.size() ? predecessorLists[node].size() : 0;
+            predecessorOffsets[node + 1] = predecessorOffsets[node] + inDegree[node];
+        }
+
+        targets.resize(offsets[nodeCount]);
+        predecessorNodes.resize(predecessorOffsets[nodeCount]);
+        for (size_t node = firstChanged; node < std::min(nodeCount, successorLists.size()); ++node)
+            std::copy(successorLists[node].begin(), successorLists[node].end(), targets.begin() + static_cast<std::ptrdiff_t>(offsets[node]));
+        for (size_t node = firstChanged; node < std::min(nodeCount, predecessorLists.size()); ++node)
+            std::copy(predecessorLists[node].begin(), predecessorLists[node].end(), predecessorNodes.begin() + static_cast<std::ptrdiff_t>(predecessorOffsets[node]));
+    }
+
+    static TCompiledGraph fromAdjacency(const size_t nodeCount, const std::unordered_map<size_t, std::vector<size_t>>& adjacency) {
+        std::vector<std::pair<size_t, size_t>> edges;
+        for (const auto& [from, tos] : adjacency)
+            for (size_t to : tos)
+                edges.emplace_back(from, to);
+        return fromEdges(nodeCount, edges);
+    }
+
+    // Turns the masked nodes into tombstones, their edges are dropped and sorters skip them, but ids stay the same
+    void removeNodes(const std::vector<bool>& mask) {
+        removed = mask;
+        removedCount = static_cast<size_t>(std::count(removed.begin(), removed.end(), true));
+        if (removedCount == 0)
+            return;
+
+        std::fill(inDegree.begin(), inDegree.end(), 0);
+        size_t write = 0;
+        for (size_t node = 0; node < size(); ++node) {
+            const size_t first = offsets[node];
+            const size_t last = offsets[node + 1];
+            offsets[node] = write;
+            if (removed[node])
+                continue;
+            for (size_t edge = first; edge < last; ++edge) {
+                if (removed[targets[edge]])
+                    continue;
+                targets[write++] = targets[edge];
+                ++inDegree[targets[edge]];
+            }
+        }
+        offsets[size()] = write;
+        targets.resize(write);
+        buildPredecessors();
+    }
+
+    // Moves node order[i] to id i, e.g. with an execution order, so walking the order becomes a sequential scan
+    // Removed nodes must be left out of 'order' and are dropped
+    TCompiledGraph renumbered(const std::vector<size_t>& order) const {
+        std::vector<size_t> remap(size(), SIZE_MAX);
+        for (size_t id = 0; id < order.size(); ++id)
+            remap[order[id]] = id;
+
+        TCompiledGraph graph;
+        graph.offsets.reserve(order.size() + 1);
+        graph.offsets.push_back(0);
+        graph.targets.reserve(edgeCount());
+        graph.inDegree.assign(order.size(), 0);
+        for (size_t node : order) {
+            const size_t first = graph.targets.size();
+            for (size_t to : successors(node)) {
+                if (remap[to] == SIZE_MAX)
+                    continue;
+                graph.targets.push_back(remap[to]);
+                ++graph.inDegree[remap[to]];
+            }
+            std::sort(graph.targets.begin() + static_cast<std::ptrdiff_t>(first), graph.targets.end());
+            graph.offsets.push_back(graph.targets.size());
+        }
+        graph.buildPredecessors();
+        return graph;
+    }
+
+    enum Direction { ANCESTORS, DESCENDANTS };
+
+    // Keeps only the targets and everything that has to run before them, or after them for DESCENDANTS
+    // Nodes keep their relative order, and originalIds receives the id each extracted node had in this graph
+    TCompiledGraph extractSubgraph(const std::vector<size_t>& targetNodes, std::vector<size_t>& originalIds, const Direction direction = ANCESTORS) const {
+        std::vector<bool> marked(size(), false);
+        std::vector<size_t> stack;
+        for (size_t node : targetNodes) {
+            if (!marked[node] && !isRemoved(node)) {
+                marked[node] = true;
+                stack.push_back(node);
+            }
+        }
+
+        while (!stack.empty()) {
+            const size_t node = stack.back();
+            stack.pop_back();
+            for (size_t next : direction == ANCESTORS ? predecessors(node) : successors(node)) {
+                if (!marked[next]) {
+                    marked[next] = true;
+                    stack.push_back(next);
+                }
+            }
+        }
+
+        std::vector<size_t> remap(size(), SIZE_MAX);
+        originalIds.clear();
+        for (size_t node = 0; node < size(); ++node) {
+            if (marked[node]) {
+                remap[node] = originalIds.size();
+                originalIds.push_back(node);
+            }
+        }
+
+        // Ids only shrink while keeping their order, so the successor lists stay sorted
+        TCompiledGraph graph;
+        graph.offsets.reserve(originalIds.size() + 1);
+        graph.offsets.push_back(0);
+        graph.inDegree.assign(originalIds.size(), 0);
+        for (size_t node : originalIds) {
+            for (size_t to : successors(node)) {
+                if (remap[to] == SIZE_MAX)
+                    continue;
+                graph.targets.push_back(remap[to]);
+                ++graph.inDegree[remap[to]];
+            }
+            graph.offsets.push_back(graph.targets.size());
+        }
+        graph.buildPredecessors();
+        return graph;
+    }
+
+    // Rebuilds the predecessors from offsets, targets and inDegree, only needed after filling those by hand
+    void buildPredecessors() {
+        predecessorOffsets.assign(size() + 1, 0);
+        for (size_t node = 0; node < size(); ++node)
+            predecessorOffsets[node + 1] = predecessorOffsets[node] + inDegree[node];
+
+        // Walking the sources in order leaves every predecessor list sorted
+        std::vector<size_t> cursor(predecessorOffsets.begin(), predecessorOffsets.end() - 1);
+        predecessorNodes.resize(edgeCount());
+        for (size_t node = 0; node < size(); ++node)
+            for (size_t to : successors(node))
+                predecessorNodes[cursor[to]++] = node;
+    }
+
+    std::vector<size_t> offsets;
+    std::vector<size_t> targets;
+    std::vector<size_t> predecessorOffsets;
+    std::vector<size_t> predecessorNodes;
+    std::vector<size_t> inDegree;
+    std::vector<bool> removed;
+    size_t removedCount = 0;
+
+private:
+
+    template <typename TForEachEdge>
+    static TCompiledGraph build(const size_t nodeCount, const size_t edgeCount, TForEachEdge&& forEachEdge) {
+        TCompiledGraph graph;
+        graph.offsets.assign(nodeCount + 1, 0);
+        graph.inDegree.assign(nodeCount, 0);
+
+        // Counting sort the edges by their source
+        forEachEdge([&](const size_t from, size_t) { ++graph.offsets[from + 1]; });
+        for (size_t i = 0; i < nodeCount; ++i)
+            graph.offsets[i + 1] += graph.offsets[i];
+
+        std::vector<size_t> cursor(graph.offsets.begin(), graph.offsets.end() - 1);
+        graph.targets.resize(edgeCount);
+        forEachEdge([&](const size_t from, const size_t to) { graph.targets[cursor[from]++] = to; });
+
+        // Hazard analysis emits the same edge once per shared resource, keep only one of each
+        size_t write = 0;
+        for (size_t node = 0; node < nodeCount; ++node) {
+            const auto first = graph.targets.begin() + static_cast<std::ptrdiff_t>(graph.offsets[node]);
+            const auto last = graph.targets.begin() + static_cast<std::ptrdiff_t>(graph.offsets[node + 1]);
+            std::sort(first, last);
+            graph.offsets[node] = write;
+            for (auto it = first; it != last; ++it) {
+                if (it != first && *it == *(it - 1))
+                    continue;
+                graph.targets[write++] = *it;
+                ++graph.inDegree[*it];
+            }
+        }
+        graph.offsets[nodeCount] = write;
+        graph.targets.resize(write);
+        graph.buildPredecessors();
+
+        return graph;
+    }
+};
+
+// Stays valid only as long as the node it was made for is alive and has not been moved by compact()
+struct TNodeHandle {
+    size_t id = SIZE_MAX;
+    uint64_t generation = 0;
+
+    bool operator==(const TNodeHandle& other) const {
+        return id == other.id && generation == other.generation;
+    }
+};
 
 template <typename TType, typename TTopologicalSorter>
 struct TDependencyGraph {
@@ -14,19 +289,152 @@ struct TDependencyGraph {
     TType& getNode(size_t id) { return nodes[id]; }
     const TType& getNode(size_t id) const { return nodes[id]; }
 
+    // Includes removed nodes until the graph is compacted
+    size_t size() const { return nodes.size(); }
+    size_t removedCount() const { return removedNodes; }
+
     template <typename... TArgs>
     size_t addNode(TArgs&&... args) {
         const size_t nodeId = nodes.size();
         nodes.emplace_back(std::forward<TArgs>(args)...);
+        generations.push_back(nextGeneration++);
         return nodeId;
     }
 
-    virtual std::vector<size_t> buildExecutionOrder() = 0;
+    TNodeHandle getHandle(const size_t id) const {
+        return TNodeHandle{id, generations[id]};
+    }
+
+    bool isValid(const TNodeHandle& handle) const {
+        return handle.id < generations.size() && generations[handle.id] == handle.generation && handle.generation != 0;
+    }
+
+    bool isRemoved(const size_t id) const {
+        return generations[id] == 0;
+    }
+
+    // Leaves a tombstone, the node keeps its id and payload but loses its edges and is skipped when sorting
+    void removeNode(const TNodeHandle& handle) {
+        if (!isValid(handle))
+            throw std::invalid_argument("Stale node handle!");
+
+        generations[handle.id] = 0;
+        ++removedNodes;
+        onRemoveNode(handle.id);
+    }
+
+    // Drops every tombstone and renumbers the remaining nodes densely, keeping their relative order
+    // Returns the new id of each old id, SIZE_MAX for removed nodes, handles to moved nodes become stale
+    std::vector<size_t> compact() {
+        std::vector<size_t> remap(nodes.size(), SIZE_MAX);
+        size_t next = 0;
+        for (size_t id = 0; id < nodes.size(); ++id)
+            if (!isRemoved(id))
+                remap[id] = next++;
+
+        if (removedNodes > 0)
+            permute(remap, next);
+        return remap;
+    }
+
+    // Moves node order[i] to id i, so nodes, edges and accesses are stored in the order they run
+    // 'order' has to be a valid execution order without removed nodes, e.g. from buildExecutionOrder
+    // Returns the new id of each old id, SIZE_MAX for removed nodes, handles to moved nodes become stale
+    std::vector<size_t> renumber(const std::vector<size_t>& order) {
+        if (order.size() + removedNodes != nodes.size())
+            throw std::invalid_argument("Renumbering needs every node that was not removed!");
+
+        std::vector<size_t> remap(nodes.size(), SIZE_MAX);
+        for (size_t id = 0; id < order.size(); ++id)
+            remap[order[id]] = id;
+
+        permute(remap, order.size());
+        return remap;
+    }
+
+    // Builds the CSR form of the graph, which can be sorted, cached or instanced
+    virtual TCompiledGraph compile() const = 0;
+
+    virtual std::vector<size_t> buildExecutionOrder() {
+        return sortCompiled(compile());
+    }
+
+    // Also fills ranks with the position of each node in the order, SIZE_MAX for removed nodes
+    // Whether one node runs before another is then a single comparison of their ranks
+    std::vector<size_t> buildExecutionOrder(std::vector<size_t>& ranks) {
+        std::vector<size_t> order = buildExecutionOrder();
+        ranks.assign(nodes.size(), SIZE_MAX);
+        for (size_t rank = 0; rank < order.size(); ++rank)
+            ranks[order[rank]] = rank;
+        return order;
+    }
 
 protected:
 
+    // Sorters that only take (nodes, dependencies), as they did before graphs compiled to CSR, get the edges as a map
+    // Such a sorter knows nothing of tombstones, so removed nodes are taken out of its order
+    std::vector<size_t> sortCompiled(const TCompiledGraph& graph) {
+        if constexpr (std::is_invocable_v<TTopologicalSorter&, const TCompiledGraph&>) {
+            return sorter(graph);
+        } else {
+            std::unordered_map<size_t, std::vector<size_t>> dependencies;
+            for (size_t node = 0; node < graph.size(); ++node)
+                if (!graph.successors(node).empty())
+                    dependencies[node].assign(graph.successors(node).begin(), graph.successors(node).end());
+
+            std::vector<size_t> order = sorter(nodes, dependencies);
+            order.erase(std::remove_if(order.begin(), order.end(), [&](const size_t node) { return graph.isRemoved(node); }), order.end());
+            return order;
+        }
+    }
+
+    // Subclasses drop what they store for a removed node
+    virtual void onRemoveNode(size_t id) = 0;
+
+    // Subclasses move what they store from each old id to remap[id], nodes mapped to SIZE_MAX are gone
+    virtual void remapNodes(const std::vector<size_t>& remap) = 0;
+
+    void permute(const std::vector<size_t>& remap, const size_t newSize) {
+        std::vector<TType> permutedNodes;
+        std::vector<uint64_t> permutedGenerations(newSize, 0);
+        permutedNodes.reserve(newSize);
+
+        std::vector<size_t> order(newSize, SIZE_MAX);
+        for (size_t id = 0; id < remap.size(); ++id)
+            if (remap[id] != SIZE_MAX)
+                order[remap[id]] = id;
+        for (size_t id : order) {
+            permutedNodes.push_back(std::move(nodes[id]));
+            permutedGenerations[permutedNodes.size() - 1] = generations[id];
+        }
+
+        nodes = std::move(permutedNodes);
+        generations = std::move(permutedGenerations);
+        removedNodes = 0;
+        remapNodes(remap);
+    }
+
+    TCompiledGraph withTombstones(TCompiledGraph graph) const {
+        applyTombstones(graph);
+        return graph;
+    }
+
+    void applyTombstones(TCompiledGraph& graph) const {
+        if (removedNodes > 0) {
+            std::vector<bool> mask(nodes.size());
+            for (size_t id = 0; id < nodes.size(); ++id)
+                mask[id] = isRemoved(id);
+            graph.removeNodes(mask);
+        }
+    }
+
     std::vector<TType> nodes;
     TTopologicalSorter sorter;
+
+    // Unique for every node ever added, 0 marks a tombstone
+    std::vector<uint64_t> generations;
+    uint64_t nextGeneration = 1;
+    size_t removedNodes = 0;
 };
 
 // Has simple dependencies
@@ -40,8 +448,98 @@ struct TSimpleDependencyGraph : TDependencyGraph<TType, TTopologicalSorter> {
         dependencies[node].push_back(dependency);
     }
 
-    virtual std::vector<size_t> buildExecutionOrder() override {
-        return sorter(nodes, dependencies);
+    virtual TCompiledGraph compile() const override {
+        return this->withTombstones(TCompiledGraph::fromAdjacency(nodes.size(), dependencies));
+    }
+
+    struct Deduplication {
+        // The node each id was merged into, its own id if it was kept, SIZE_MAX if it was already removed
+        std::vector<size_t> mergedInto;
+        size_t mergedCount = 0;
+        // Sum of the cost of every merged node, the work that no longer runs
+        double savedWork = 0.0;
+    };
+
+    // Merges every node equal to an earlier one with the same predecessors into it, its dependents then depend on the kept node
+    // Merged nodes are removed, so duplicates of duplicates collapse too as their predecessors become the same
+    template <typename TNodeHash, typename TNodeEqual, typename TNodeCost>
+    Deduplication mergeDuplicates(TNodeHash&& nodeHash, TNodeEqual&& nodeEqual, TNodeCost&& nodeCost) {
+        const TCompiledGraph graph = compile();
+        Deduplication result;
+        result.mergedInto.assign(nodes.size(), SIZE_MAX);
+
+        // Predecessors of each kept node, as kept nodes, sorted
+        std::vector<std::vector<size_t>> keptPredecessors(nodes.size());
+        std::unordered_map<size_t, std::vector<size_t>> keptByHash;
+        std::vector<size_t> duplicates;
+
+        for (size_t node : this->sortCompiled(graph)) {
+            std::vector<size_t> predecessors;
+            for (size_t predecessor : graph.predecessors(node))
+                predecessors.push_back(result.mergedInto[predecessor]);
+            std::sort(predecessors.begin(), predecessors.end());
+            predecessors.erase(std::unique(predecessors.begin(), predecessors.end()), predecessors.end());
+
+            size_t hash = static_cast<size_t>(nodeHash(nodes[node]));
+            for (size_t predecessor : predecessors)
+                hash ^= predecessor + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+
+            auto& candidates = keptByHash[hash];
+            const auto original = std::find_if(candidates.begin(), candidates.end(), [&](const size_t candidate) {
+                return keptPredecessors[candidate] == predecessors && nodeEqual(nodes[candidate], nodes[node]);
+            });
+
+            if (original == candidates.end()) {
+                result.mergedInto[node] = node;
+                keptPredecessors[node] = std::move(predecessors);
+                candidates.push_back(node);
+            } else {
+                result.mergedInto[node] = *original;
+                duplicates.push_back(node);
+            }
+        }
+
+        for (size_t duplicate : duplicates) {
+            const auto found = dependencies.find(duplicate);
+            if (found != dependencies.end()) {
+                const std::vector<size_t>& dependents = found->second;
+                auto& keptDependents = dependencies[result.mergedInto[duplicate]];
+                // Edges to removed nodes are left behind by removeNode, they have nothing to move to
+                for (size_t dependent : dependents)
+                    if (result.mergedInto[dependent] != SIZE_MAX)
+                        keptDependents.push_back(result.mergedInto[dependent]);
+            }
+
+            result.savedWork += static_cast<double>(nodeCost(nodes[duplicate]));
+            this->removeNode(this->getHandle(duplicate));
+        }
+        result.mergedCount = duplicates.size();
+
+        return result;
+    }
+
+    template <typename TNodeHash, typename TNodeEqual>
+    Deduplication mergeDuplicates(TNodeHash&& nodeHash, TNodeEqual&& nodeEqual) {
+        return mergeDuplicates(std::forward<TNodeHash>(nodeHash), std::forward<TNodeEqual>(nodeEqual), [](const TType&) { return 1.0; });
+    }
+
+protected:
+
+    virtual void onRemoveNode(const size_t id) override {
+        dependencies.erase(id);
+    }
+
+    virtual void remapNodes(const std::vector<size_t>& remap) override {
+        std::unordered_map<size_t, std::vector<size_t>> remapped;
+        for (const auto& [node, tos] : dependencies) {
+            if (remap[node] == SIZE_MAX)
+                continue;
+            auto& remappedTos = remapped[remap[node]];
+            for (size_t to : tos)
+                if (remap[to] != SIZE_MAX)
+                    remappedTos.push_back(remap[to]);
+        }
+        dependencies = std::move(remapped);
     }
 
 private:
@@ -50,6 +548,44 @@ private:
 
 };
 
+// Why one pass has to run after another
+template <typename TDependencyType>
+struct THazard {
+    enum Type { RAW, WAR, WAW };
+
+    size_t from;
+    size_t to;
+    TDependencyType resource;
+    Type type;
+};
+
+// How a group of passes that solved its hazards among itself accesses one resource, e.g. an instance of a template
+// Only these accesses can order the group against passes outside of it, pass ids are relative to the first pass of the group
+struct TResourceBoundary {
+    // Passes reading before the first write, every reader if nothing writes
+    std::vector<size_t> entryReaders;
+    size_t firstWriter = SIZE_MAX;
+    size_t lastWriter = SIZE_MAX;
+    // Passes reading after the last write
+    std::vector<size_t> exitReaders;
+    size_t lastAccessor = SIZE_MAX;
+
+    // Accesses have to arrive in declaration order
+    void access(const size_t node, const bool write) {
+        lastAccessor = node;
+        if (write) {
+            if (firstWriter == SIZE_MAX)
+                firstWriter = node;
+            lastWriter = node;
+            exitReaders.clear();
+        } else {
+            std::vector<size_t>& readers = firstWriter == SIZE_MAX ? entryReaders : exitReaders;
+            if (readers.empty() || readers.back() != node)
+                readers.push_back(node);
+        }
+    }
+};
+
 // Read and Write dependencies
 template <typename TType, typename TDependencyType, typename TTopologicalSorter>
 struct TRWDependencyGraph : TDependencyGraph<TType, TTopologicalSorter> {
@@ -59,64 +595,547 @@ struct TRWDependencyGraph : TDependencyGraph<TType, TTopologicalSorter> {
         enum { READ, WRITE } type;
     };
 
+    struct Hasher {
+        size_t operator()(const TDependencyType& p) const noexcept {
+            return getHash(p);
+        }
+    };
+
+    using Hazard = THazard<TDependencyType>;
+
+    // How a resource lives beyond a single execution of the graph
+    enum ResourceKind {
+        // Only exists while the graph executes, so its memory can be shared with other transient resources
+        TRANSIENT,
+        // Owned outside the graph, e.g. the swapchain, the outside wrote it before the first execution
+        IMPORTED,
+        // Double buffered across executions, reads before the first write of an execution see the previous execution's version
+        // Those reads still run before the first write, which flips the buffers, but that ordering never needs a barrier
+        TEMPORAL
+    };
+
     using TDependencyGraph<TType, TTopologicalSorter>::nodes;
     using TDependencyGraph<TType, TTopologicalSorter>::sorter;
+    using TDependencyGraph<TType, TTopologicalSorter>::buildExecutionOrder;
 
+    // Hazards are resolved as accesses are added, so building again only has to sort
+    // Adding an access to a pass older than the last pass that touched the resource falls back to a full analysis on the next compile
     void addRead(size_t node, const TDependencyType dependency) {
         dependencies[node].emplace_back(Access{dependency, Access::READ});
+        trackHazards(node, dependencies[node].back());
+        trackPersistent(node, dependencies[node].back());
     }
 
     void addWrite(size_t node, const TDependencyType dependency) {
         dependencies[node].emplace_back(Access{dependency, Access::WRITE});
+        trackHazards(node, dependencies[node].back());
+        trackPersistent(node, dependencies[node].back());
+    }
+
+    // Adds the accesses of passes whose hazards among themselves were solved elsewhere, e.g. an instance of a template
+    // 'edges' holds those hazards, its pass i is pass (first + i) here, and the passes from 'first' on must not have accesses yet
+    // forEachAccess(visit) calls visit(node, resource, write) for every access in declaration order, they are only stored
+    // forEachBoundary(visit) calls visit(resource, boundary) once per resource, only that is analyzed against the earlier passes
+    // A full analysis of the stored accesses finds the same hazards as 'edges' and the boundaries together
+    template <typename TForEachAccess, typename TForEachBoundary>
+    void addSolvedPasses(const size_t first, const TCompiledGraph& edges, TForEachAccess&& forEachAccess, TForEachBoundary&& forEachBoundary) {
+        if (liveHazards && edges.edgeCount() > 0) {
+            if (liveSuccessors.size() < first + edges.size()) {
+                liveSuccessors.resize(first + edges.size());
+                livePredecessors.resize(first + edges.size());
+            }
+            // Adding 'first' keeps every list sorted, so the lists are copied as a whole
+            const auto append = [first](std::vector<size_t>& list, const TCompiledGraph::Range range) {
+                if (list.empty()) {
+                    list.resize(range.size());
+                    std::transform(range.begin(), range.end(), list.begin(), [first](const size_t node) { return first + node; });
+                } else {
+                    for (size_t node : range)
+                        insertSorted(list, first + node);
+                }
+            };
+            for (size_t node = 0; node < edges.size(); ++node) {
+                append(liveSuccessors[first + node], edges.successors(node));
+                append(livePredecessors[first + node], edges.predecessors(node));
+            }
+            liveFirstChanged = std::min(liveFirstChanged, first);
+        }
+
+        // Counting first lets every pass allocate its accesses once
+        std::vector<size_t> accessCounts(edges.size(), 0);
+        forEachAccess([&](const size_t node, const TDependencyType&, bool) { ++accessCounts[node - first]; });
+
+        size_t current = SIZE_MAX;
+        std::vector<Access>* accesses = nullptr;
+        forEachAccess([&](const size_t node, const TDependencyType& resource, const bool write) {
+            if (node != current) {
+                current = node;
+                accesses = &dependencies[node];
+                accesses->reserve(accesses->size() + accessCounts[node - first]);
+            }
+            accesses->emplace_back(Access{resource, write ? Access::WRITE : Access::READ});
+            trackPersistent(node, accesses->back());
+        });
+
+        forEachBoundary([&](const TDependencyType& resource, const TResourceBoundary& boundary) {
+            if (!liveHazards)
+                return;
+
+            ResourceState& state = liveStates[resource];
+            if (state.lastAccessor != SIZE_MAX && state.lastAccessor >= first) {
+                resetLiveHazards();
+                return;
+            }
+            state.access(first, boundary, liveEmitter());
+        });
     }
 
+    // Explicit ordering on top of the hazards, 'dependency' will run after 'node'
+    void addDependency(const size_t node, const size_t dependency) {
+        explicitDependencies.emplace_back(node, dependency);
+        if (liveHazards)
+            addLiveEdge(node, dependency);
+    }
+
+    // (node, dependency) pairs added with addDependency
+    const std::vector<std::pair<size_t, size_t>>& getExplicitDependencies() const { return explicitDependencies; }
+
+    // Resources are transient unless set otherwise
+    void setResourceKind(const TDependencyType& resource, const ResourceKind kind) {
+        if (kind == TRANSIENT)
+            resourceKinds.erase(resource);
+        else
+            resourceKinds[resource] = kind;
+        persistentAccessesValid = false;
+    }
+
+    ResourceKind getResourceKind(const TDependencyType& resource) const {
+        const auto kind = resourceKinds.find(resource);
+        return kind == resourceKinds.end() ? TRANSIENT : kind->second;
+    }
+
+    // Also carries the state of imported and temporal resources over to the next execution
+    // Refreshes the live compiled graph in place and sorts it, so building again after a few new passes copies nothing
     virtual std::vector<size_t> buildExecutionOrder() override {
-        std::unordered_map<size_t, std::vector<size_t>> outDependencies;
+        std::vector<size_t> order = hazardThreads <= 1 ? this->sortCompiled(refreshLive()) : this->sortCompiled(compile());
+        carryHistory();
+        return order;
+    }
+
+    // Hazards of the last built execution on the one before it, 'from' is always SIZE_MAX
+    // The pass in 'to' has to wait until the previous execution is done with the resource, e.g. behind a fence
+    const std::vector<Hazard>& getCarriedHazards() const { return carriedHazards; }
+
+    // Forgets what previous executions did with imported and temporal resources, e.g. after a camera cut
+    void resetHistory() {
+        history.clear();
+        carriedHazards.clear();
+    }
+
+    // Hazards of different resources never interact, so with more than one thread the accesses are split by resource
+    // and each share is analyzed on its own thread, the results are identical to the serial analysis
+    // This replaces the incremental analysis, which is serial by nature
+    void setHazardThreads(const size_t threadCount) {
+        hazardThreads = std::max<size_t>(threadCount, 1);
+        if (hazardThreads > 1)
+            resetLiveHazards();
+    }
+
+    // Changes nothing, so several threads can compile the same graph, only building refreshes the live compiled graph
+    virtual TCompiledGraph compile() const override {
+        if (hazardThreads <= 1 && liveHazards) {
+            if (liveFirstChanged == SIZE_MAX && liveGraph.size() == nodes.size())
+                return liveGraph;
+            return this->withTombstones(TCompiledGraph::fromSortedLists(nodes.size(), liveSuccessors, livePredecessors));
+        }
 
-        struct ResourceState {
-            size_t lastWriter = SIZE_MAX;
-           std::unordered_set<size_t> lastReaders;
+        // Bucketing keeps declaration order inside each shard, which is all the analysis of a resource needs
+        const Hasher hasher;
+        std::vector<std::vector<std::pair<size_t, const Access*>>> shards(hazardThreads);
+        for (size_t node = 0; node < nodes.size(); ++node) {
+            const auto accesses = dependencies.find(node);
+            if (accesses != dependencies.end())
+                for (const auto& access : accesses->second)
+                    shards[hasher(access.node) % hazardThreads].emplace_back(node, &access);
+        }
+
+        std::vector<std::vector<std::pair<size_t, size_t>>> edgeLists(hazardThreads);
+        const auto analyzeShard = [this, &shards, &edgeLists](const size_t shard) {
+            std::unordered_map<TDependencyType, ResourceState, Hasher> resourceStates;
+            analyzeHazards(resourceStates, edgeEmitter(edgeLists[shard]), [&](auto&& visit) {
+                for (const auto& [node, access] : shards[shard])
+                    visit(node, *access);
+            });
         };
 
-        struct Hasher {
-            size_t operator()(const TDependencyType& p) const noexcept {
-                return getHash(p);
+        // A single shard, when the live edges are out of date after a removal, is analyzed right here
+        std::vector<std::thread> threads;
+        for (size_t shard = 1; shard < hazardThreads; ++shard)
+            threads.emplace_back(analyzeShard, shard);
+        analyzeShard(0);
+        for (auto& thread : threads)
+            thread.join();
+
+        std::vector<const std::vector<std::pair<size_t, size_t>>*> edgePointers{&explicitDependencies};
+        for (const auto& edges : edgeLists)
+            edgePointers.push_back(&edges);
+        return this->withTombstones(TCompiledGraph::fromEdgeLists(nodes.size(), edgePointers));
+    }
+
+    // Every hazard with the resource and rule that caused it, in the order the accesses were declared
+    std::vector<Hazard> computeHazards() const {
+        std::vector<Hazard> hazards;
+        std::unordered_map<TDependencyType, ResourceState, Hasher> resourceStates;
+        for (size_t node = 0; node < nodes.size(); ++node) {
+            const auto accesses = dependencies.find(node);
+            if (accesses == dependencies.end())
+                continue;
+
+            for (const auto& access : accesses->second) {
+                resourceStates[access.node].access(node, access.type, [&](const size_t from, const size_t to, const typename Hazard::Type type) {
+                    hazards.push_back(Hazard{from, to, access.node, type});
+                });
+            }
+        }
+        return hazards;
+    }
+
+    // Ranks of the first and last pass in an order that access a resource, it has to exist in between
+    // Imported and temporal resources live beyond the order, so they span all of it and are never aliased
+    struct Lifetime {
+        TDependencyType resource;
+        size_t first;
+        size_t last;
+        bool persistent = false;
+    };
+
+    // Resources are listed in the order they are first used
+    std::vector<Lifetime> computeLifetimes(const std::vector<size_t>& order) const {
+        std::vector<Lifetime> lifetimes;
+        std::unordered_map<TDependencyType, size_t, Hasher> indices;
+        for (size_t rank = 0; rank < order.size(); ++rank) {
+            const auto accesses = dependencies.find(order[rank]);
+            if (accesses == dependencies.end())
+                continue;
+
+            for (const auto& access : accesses->second) {
+                const auto [it, inserted] = indices.try_emplace(access.node, lifetimes.size());
+                if (inserted)
+                    lifetimes.push_back(Lifetime{access.node, rank, rank});
+                else
+                    lifetimes[it->second].last = rank;
             }
+        }
+
+        for (auto& lifetime : lifetimes) {
+            if (getResourceKind(lifetime.resource) != TRANSIENT) {
+                lifetime.first = 0;
+                lifetime.last = order.size() - 1;
+                lifetime.persistent = true;
+            }
+        }
+        return lifetimes;
+    }
+
+    // The most resources that are alive during a single pass of the order
+    size_t peakLiveResources(const std::vector<size_t>& order) const {
+        std::vector<int64_t> delta(order.size() + 1, 0);
+        for (const auto& lifetime : computeLifetimes(order)) {
+            ++delta[lifetime.first];
+            --delta[lifetime.last + 1];
+        }
+
+        int64_t live = 0, peak = 0;
+        for (size_t rank = 0; rank < order.size(); ++rank) {
+            live += delta[rank];
+            peak = std::max(peak, live);
+        }
+        return static_cast<size_t>(peak);
+    }
+
+    std::unordered_map<size_t, std::vector<Access>> dependencies;
+
+protected:
+
+    // The accesses of a removed pass are gone, which changes the hazards of every pass after it
+    virtual void onRemoveNode(const size_t id) override {
+        dependencies.erase(id);
+        resetLiveHazards();
+        persistentAccessesValid = false;
+    }
+
+    virtual void remapNodes(const std::vector<size_t>& remap) override {
+        std::unordered_map<size_t, std::vector<Access>> remapped;
+        for (auto& [node, accesses] : dependencies)
+            if (remap[node] != SIZE_MAX)
+                remapped[remap[node]] = std::move(accesses);
+        dependencies = std::move(remapped);
+
+        std::vector<std::pair<size_t, size_t>> remappedDependencies;
+        for (const auto& [node, dependency] : explicitDependencies)
+            if (remap[node] != SIZE_MAX && remap[dependency] != SIZE_MAX)
+                remappedDependencies.emplace_back(remap[node], remap[dependency]);
+        explicitDependencies = std::move(remappedDependencies);
+
+        std::vector<Hazard> remappedHazards;
+        for (const Hazard& hazard : carriedHazards)
+            if (remap[hazard.to] != SIZE_MAX)
+                remappedHazards.push_back(Hazard{SIZE_MAX, remap[hazard.to], hazard.resource, hazard.type});
+        carriedHazards = std::move(remappedHazards);
+        persistentAccessesValid = false;
+
+        resetLiveHazards();
+    }
+
+    struct ResourceState {
+        size_t lastWriter = SIZE_MAX;
+        size_t lastAccessor = SIZE_MAX;
+        // Accesses of a resource arrive in pass order, so a pass reading twice is always the last reader
+        std::vector<size_t> lastReaders;
+
+        // Calls emit(from, to, type) for every hazard the access causes
+        template <typename TEmit>
+        void access(const size_t node, const decltype(Access::type) type, TEmit&& emit) {
+            lastAccessor = node;
+            switch (type) {
+            case Access::READ:
+                // RAW - When reading from a resource, the last one who wrote to it must run first
+                if (lastWriter != SIZE_MAX && lastWriter != node)
+                    emit(lastWriter, node, Hazard::RAW);
+                if (lastReaders.empty() || lastReaders.back() != node)
+                    lastReaders.push_back(node);
+                break;
+            case Access::WRITE:
+                // WAW - When writing to a resource, we must wait on the previous writer before writing to it
+                if (lastWriter != SIZE_MAX && lastWriter != node)
+                    emit(lastWriter, node, Hazard::WAW);
+                // WAR - When writing to a resource, we must wait on the previous readers before writing to it, as to not change it while reading
+                for (size_t reader : lastReaders)
+                    if (reader != node)
+                        emit(reader, node, Hazard::WAR);
+                lastReaders.clear();
+                lastWriter = node;
+                break;
+            default: break;
+            }
+        }
+
+        // Same as every access of the boundary, of a group of passes starting at 'first', one after the other
+        // Hazards inside the group are left out, only the accesses before the first write can see the passes before it
+        template <typename TEmit>
+        void access(const size_t first, const TResourceBoundary& boundary, TEmit&& emit) {
+            lastAccessor = first + boundary.lastAccessor;
+            if (lastWriter != SIZE_MAX) {
+                for (size_t reader : boundary.entryReaders)
+                    emit(lastWriter, first + reader, Hazard::RAW);
+                if (boundary.firstWriter != SIZE_MAX)
+                    emit(lastWriter, first + boundary.firstWriter, Hazard::WAW);
+            }
+
+            if (boundary.firstWriter == SIZE_MAX) {
+                for (size_t reader : boundary.entryReaders)
+                    lastReaders.push_back(first + reader);
+                return;
+            }
+
+            for (size_t reader : lastReaders)
+                emit(reader, first + boundary.firstWriter, Hazard::WAR);
+            lastReaders.clear();
+            for (size_t reader : boundary.exitReaders)
+                lastReaders.push_back(first + reader);
+            lastWriter = first + boundary.lastWriter;
+        }
+    };
+
+    static auto edgeEmitter(std::vector<std::pair<size_t, size_t>>& edges) {
+        return [&edges](const size_t from, const size_t to, typename Hazard::Type) { edges.emplace_back(from, to); };
+    }
+
+    auto liveEmitter() {
+        return [this](const size_t from, const size_t to, typename Hazard::Type) { addLiveEdge(from, to); };
+    }
+
+    // Keeps both live lists sorted and without duplicates, edges to the newest pass, the usual case, are appended
+    static bool insertSorted(std::vector<size_t>& list, const size_t value) {
+        if (list.empty() || list.back() < value) {
+            list.push_back(value);
+            return true;
+        }
+        const auto position = std::lower_bound(list.begin(), list.end(), value);
+        if (*position == value)
+            return false;
+        list.insert(position, value);
+        return true;
+    }
+
+    void addLiveEdge(const size_t from, const size_t to) {
+        const size_t needed = std::max(from, to) + 1;
+        if (liveSuccessors.size() < needed) {
+            liveSuccessors.resize(needed);
+            livePredecessors.resize(needed);
+        }
+        if (insertSorted(liveSuccessors[from], to)) {
+            insertSorted(livePredecessors[to], from);
+            liveFirstChanged = std::min(liveFirstChanged, std::min(from, to));
+        }
+    }
+
+    template <typename TEmit, typename TForEachAccess>
+    void analyzeHazards(std::unordered_map<TDependencyType, ResourceState, Hasher>& resourceStates, TEmit&& emit, TForEachAccess&& forEachAccess) const {
+        forEachAccess([&](const size_t node, const Access& access) {
+            resourceStates[access.node].access(node, access.type, emit);
+        });
+    }
+
+    void trackHazards(const size_t node, const Access& access) {
+        if (!liveHazards)
+            return;
+
+        ResourceState& state = liveStates[access.node];
+        if (state.lastAccessor != SIZE_MAX && node < state.lastAccessor) {
+            resetLiveHazards();
+            return;
+        }
+        state.access(node, access.type, liveEmitter());
+    }
+
+    // The live edges in CSR form, refreshed in its own memory and only when something changed since the last build
+    const TCompiledGraph& refreshLive() {
+        if (!liveHazards) {
+            resetLiveHazards();
+            for (const auto& [node, dependency] : explicitDependencies)
+                addLiveEdge(node, dependency);
+            analyzeHazards(liveStates, liveEmitter(), [&](auto&& visit) {
+                // Accesses are walked in declaration order, so hazards always point from earlier passes to later ones
+                for (size_t node = 0; node < nodes.size(); ++node) {
+                    const auto accesses = dependencies.find(node);
+                    if (accesses != dependencies.end())
+                        for (const auto& access : accesses->second)
+                            visit(node, access);
+                }
+            });
+            liveHazards = true;
+        }
+
+        // Passes are mostly added at the end, so only the tail of the CSR has to be written again
+        if (liveFirstChanged != SIZE_MAX || liveGraph.size() != nodes.size()) {
+            liveGraph.assignSortedLists(nodes.size(), liveSuccessors, livePredecessors, liveFirstChanged);
+            this->applyTombstones(liveGraph);
+            liveFirstChanged = SIZE_MAX;
+        }
+        return liveGraph;
+    }
+
+    void resetLiveHazards() {
+        liveHazards = false;
+        liveFirstChanged = 0;
+        liveStates.clear();
+        liveSuccessors.clear();
+        livePredecessors.clear();
+    }
+
+    // What the executions so far left behind in a persistent resource
+    struct History {
+        bool written = false;
+        // Imported resources, read after the last write
+        bool readAfterWrite = false;
+        // Temporal resources, the previous version was read, so the buffer the next execution writes is still in use
+        bool readBeforeWrite = false;
+    };
+
+    // Compares the first accesses of every persistent resource to the history, then moves the history past this execution
+    void trackPersistent(const size_t node, const Access& access) {
+        if (persistentAccessesValid && !resourceKinds.empty() && getResourceKind(access.node) != TRANSIENT)
+            persistentAccesses.emplace_back(node, access);
+    }
+
+    void carryHistory() {
+        carriedHazards.clear();
+        if (resourceKinds.empty())
+            return;
+
+        // Accesses to persistent resources are collected as they are added, only a kind change or removal walks every access again
+        if (!persistentAccessesValid) {
+            persistentAccesses.clear();
+            for (size_t node = 0; node < nodes.size(); ++node) {
+                const auto accesses = dependencies.find(node);
+                if (accesses != dependencies.end())
+                    for (const auto& access : accesses->second)
+                        if (getResourceKind(access.node) != TRANSIENT)
+                            persistentAccesses.emplace_back(node, access);
+            }
+            persistentAccessesValid = true;
+        }
+        const auto byNode = [](const auto& a, const auto& b) { return a.first < b.first; };
+        if (!std::is_sorted(persistentAccesses.begin(), persistentAccesses.end(), byNode))
+            std::stable_sort(persistentAccesses.begin(), persistentAccesses.end(), byNode);
+
+        const auto carry = [&](const size_t node, const TDependencyType& resource, const typename Hazard::Type type) {
+            if (carriedHazards.empty() || carriedHazards.back().to != node || carriedHazards.back().type != type || !(carriedHazards.back().resource == resource))
+                carriedHazards.push_back(Hazard{SIZE_MAX, node, resource, type});
         };
 
-        std::unordered_map<TDependencyType, ResourceState, Hasher> resourceStates;
+        std::unordered_map<TDependencyType, History, Hasher> progress;
+        for (const auto& [node, access] : persistentAccesses) {
+            const ResourceKind kind = getResourceKind(access.node);
 
-        for (const auto& [node, accesses] : dependencies) {
-            for (const auto& access : accesses) {
-                ResourceState& currentResourceState = resourceStates[access.node];
-
-                switch (access.type) {
-                case Access::READ:
-                    // RAW - When reading from a resource, the last one who wrote to it must run first
-                    if (currentResourceState.lastWriter != SIZE_MAX && currentResourceState.lastWriter != node)
-                        outDependencies[currentResourceState.lastWriter].emplace_back(node);
-                    currentResourceState.lastReaders.emplace(node);
-                    break;
-                case Access::WRITE:
-                    // WAW - When writing to a resource, we must wait on the previous writer before writing to it
-                    if (currentResourceState.lastWriter != SIZE_MAX && currentResourceState.lastWriter != node)
-                        outDependencies[currentResourceState.lastWriter].emplace_back(node);
-                    // WAR - When writing to a resource, we must wait on the previous readers before writing to it, as to not change it while reading
-                    for (size_t reader : currentResourceState.lastReaders)
-                        if (reader != node)
-                            outDependencies[reader].emplace_back(node);
-                    currentResourceState.lastReaders.clear();
-                    currentResourceState.lastWriter = node;
-                    break;
-                default: break;
+            const auto found = history.find(access.node);
+            const History previous = found != history.end() ? found->second : History{kind == IMPORTED};
+            History& current = progress[access.node];
+            if (access.type == Access::READ) {
+                if (current.written) {
+                    current.readAfterWrite = true;
+                    continue;
                 }
+                if (previous.written)
+                    carry(node, access.node, Hazard::RAW);
+                current.readBeforeWrite = true;
+            } else {
+                if (!current.written) {
+                    if (kind == IMPORTED && previous.written)
+                        carry(node, access.node, Hazard::WAW);
+                    if (kind == IMPORTED ? previous.readAfterWrite : previous.readBeforeWrite)
+                        carry(node, access.node, Hazard::WAR);
+                }
+                current.written = true;
+                current.readAfterWrite = false;
             }
         }
 
-        return sorter(nodes, outDependencies);
+        for (const auto& [resource, current] : progress) {
+            const auto [found, inserted] = history.try_emplace(resource, History{getResourceKind(resource) == IMPORTED});
+            History& previous = found->second;
+            if (getResourceKind(resource) == IMPORTED) {
+                previous.readAfterWrite = current.written ? current.readAfterWrite : previous.readAfterWrite || current.readBeforeWrite;
+                previous.written = previous.written || current.written;
+            } else if (current.written) {
+                previous.written = true;
+                previous.readBeforeWrite = current.readBeforeWrite;
+            }
+        }
     }
 
-    std::unordered_map<size_t, std::vector<Access>> dependencies;
+    std::vector<std::pair<size_t, size_t>> explicitDependencies;
+
+    std::unordered_map<TDependencyType, ResourceKind, Hasher> resourceKinds;
+    std::unordered_map<TDependencyType, History, Hasher> history;
+    std::vector<Hazard> carriedHazards;
+    // Every access to an imported or temporal resource with its pass, sorted by pass before use
+    std::vector<std::pair<size_t, Access>> persistentAccesses;
+    bool persistentAccessesValid = false;
+
+    // Resource states and edges of every access and explicit dependency so far, kept between builds while accesses arrive in declaration order
+    // The edges are kept as sorted lists per pass, so compiling only copies them into CSR
+    // Only non-const calls change them, a const graph can be compiled from any number of threads
+    std::unordered_map<TDependencyType, ResourceState, Hasher> liveStates;
+    std::vector<std::vector<size_t>> liveSuccessors;
+    std::vector<std::vector<size_t>> livePredecessors;
+    TCompiledGraph liveGraph;
+    // Lowest pass whose edges changed since liveGraph was refreshed, SIZE_MAX if none did
+    size_t liveFirstChanged = 0;
+    bool liveHazards = true;
+
+    size_t hazardThreads = 1;
 };
 
 
@@ -126,45 +1145,64 @@ struct TKahnTopologicalSort {
 
     template <typename TType>
     std::vector<size_t> operator()(const std::vector<TType>& nodes, const std::unordered_map<size_t, std::vector<size_t>>& dependencies) const {
-        std::vector<int> inDegree;
-
-        // Each node starts with 0 dependencies
-        for (size_t i = 0; i < nodes.size(); ++i)
-            inDegree.push_back(0);
-
-        // Add one whenever a node is a dependency, a node that nothing depends on will be 0
-        for (size_t i = 0; i < nodes.size(); ++i)
-            if (dependencies.find(i) != dependencies.end())
-                for (size_t to : dependencies.at(i))
-                    ++inDegree[to];
+        return (*this)(TCompiledGraph::fromAdjacency(nodes.size(), dependencies));
+    }
 
-        // Each node that nothing depends on will be added to queue
-        std::queue<size_t> q;
-        for (size_t id = 0; id < inDegree.size(); ++id)
-            if (inDegree[id] == 0)
-                q.push(id);
+    // Works on any compiled form, e.g. TCompiledGraph or TCompressedGraph
+    template <typename TGraph>
+    std::vector<size_t> operator()(const TGraph& graph) const {
+        // A node that nothing depends on starts at 0
+        std::vector<size_t> inDegree(graph.inDegree.begin(), graph.inDegree.end());
 
+        // The order doubles as the queue, everything behind 'head' has been visited
         std::vector<size_t> order;
+        order.reserve(graph.size());
+        for (size_t id = 0; id < inDegree.size(); ++id)
+            if (inDegree[id] == 0 && !graph.isRemoved(id))
+                order.push_back(id);
 
-        while (!q.empty()) {
-
-            // Push the nodes with no dependencies into the list
-            size_t id = q.front(); q.pop();
-            order.push_back(id);
-
+        for (size_t head = 0; head < order.size(); ++head) {
             // For each node that is no longer a dependent, add to the queue
-            if (dependencies.find(id) != dependencies.end()) {
-                for (auto& dependency : dependencies.at(id)) {
-                    if (--inDegree[dependency] == 0) {
-                        q.push(dependency);
-                    }
+            for (size_t dependency : graph.successors(order[head])) {
+                if (--inDegree[dependency] == 0) {
+                    order.push_back(dependency);
                 }
             }
         }
 
-        if (order.size() != nodes.size())
+        if (order.size() + graph.removedCount != graph.size())
             throw std::runtime_error("Cycle detected in dependency graph!");
 
         return order;
     }
-};
\ No newline at end of file
+};
+
+// Orders nodes by level, i.e. the longest chain of dependencies before them, so every wave of independent nodes is contiguous
+// Renumbering a graph in this order keeps each wave together in memory
+struct TLevelTopologicalSort {
+
+    template <typename TGraph>
+    std::vector<size_t> operator()(const TGraph& graph) const {
+        const std::vector<size_t> order = TKahnTopologicalSort{}(graph);
+
+        std::vector<size_t> level(graph.size(), 0);
+        size_t levelCount = 0;
+        for (size_t node : order) {
+            levelCount = std::max(levelCount, level[node] + 1);
+            for (size_t dependency : graph.successors(node))
+                level[dependency] = std::max(level[dependency], level[node] + 1);
+        }
+
+        // Counting sort by level, stable so each level keeps the Kahn order
+        std::vector<size_t> offsets(levelCount + 1, 0);
+        for (size_t node : order)
+            ++offsets[level[node] + 1];
+        for (size_t i = 0; i < levelCount; ++i)
+            offsets[i + 1] += offsets[i];
+
+        std::vector<size_t> levelOrder(order.size());
+        for (size_t node : order)
+            levelOrder[offsets[level[node]]++] = node;
+        return levelOrder;
+    }
+};
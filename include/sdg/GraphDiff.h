@@ -0,0 +1,159 @@
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "StructuralHash.h"
+
+// What changed between two versions of a graph, so caches keyed on nodes, edges or hazards can be patched rather than rebuilt
+// Nodes are matched by structural hash first, then by identity, so ids do not have to line up between the versions
+struct TGraphDiff {
+
+    // New ids of nodes with no counterpart in the old graph
+    std::vector<size_t> addedNodes;
+    // Old ids of nodes with no counterpart in the new graph
+    std::vector<size_t> removedNodes;
+    // New ids of nodes that are the same themselves, but something upstream of them changed
+    std::vector<size_t> changedNodes;
+    // Old id of each new node, SIZE_MAX for added ones
+    std::vector<size_t> newToOld;
+    // New id of each old node, SIZE_MAX for removed ones
+    std::vector<size_t> oldToNew;
+
+    // Edges in new ids
+    std::vector<std::pair<size_t, size_t>> addedEdges;
+    // Edges in old ids
+    std::vector<std::pair<size_t, size_t>> removedEdges;
+
+    bool empty() const {
+        return addedNodes.empty() && removedNodes.empty() && changedNodes.empty() && addedEdges.empty() && removedEdges.empty();
+    }
+
+    // Linear in the size of both graphs, up to the binary search of each edge in the successors of its node
+    static TGraphDiff compute(const TCompiledGraph& oldGraph, const TStructuralHashes& oldHashes, const TCompiledGraph& newGraph, const TStructuralHashes& newHashes) {
+        TGraphDiff diff;
+        diff.newToOld.assign(newGraph.size(), SIZE_MAX);
+        diff.oldToNew.assign(oldGraph.size(), SIZE_MAX);
+
+        // Equal keys are paired off in id order, so repeated passes keep their relative order
+        const auto match = [&](const std::vector<uint64_t>& oldKeys, const std::vector<uint64_t>& newKeys, const bool changed) {
+            std::unordered_map<uint64_t, std::deque<size_t>> candidates;
+            for (size_t node = 0; node < oldGraph.size(); ++node)
+                if (!oldGraph.isRemoved(node) && diff.oldToNew[node] == SIZE_MAX)
+                    candidates[oldKeys[node]].push_back(node);
+
+            for (size_t node = 0; node < newGraph.size(); ++node) {
+                if (newGraph.isRemoved(node) || diff.newToOld[node] != SIZE_MAX)
+                    continue;
+
+                const auto candidate = candidates.find(newKeys[node]);
+                if (candidate == candidates.end() || candidate->second.empty())
+                    continue;
+
+                const size_t oldNode = candidate->second.front();
+                candidate->second.pop_front();
+                diff.newToOld[node] = oldNode;
+                diff.oldToNew[oldNode] = node;
+                if (changed)
+                    diff.changedNodes.push_back(node);
+            }
+        };
+        match(oldHashes.nodes, newHashes.nodes, false);
+        match(oldHashes.identities, newHashes.identities, true);
+
+        for (size_t node = 0; node < newGraph.size(); ++node)
+            if (!newGraph.isRemoved(node) && diff.newToOld[node] == SIZE_MAX)
+                diff.addedNodes.push_back(node);
+        for (size_t node = 0; node < oldGraph.size(); ++node)
+            if (!oldGraph.isRemoved(node) && diff.oldToNew[node] == SIZE_MAX)
+                diff.removedNodes.push_back(node);
+
+        const auto hasEdge = [](const TCompiledGraph& graph, const size_t from, const size_t to) {
+            const auto successors = graph.successors(from);
+            return std::binary_search(successors.begin(), successors.end(), to);
+        };
+
+        for (size_t node = 0; node < newGraph.size(); ++node) {
+            for (size_t successor : newGraph.successors(node)) {
+                const size_t oldFrom = diff.newToOld[node];
+                const size_t oldTo = diff.newToOld[successor];
+                if (oldFrom == SIZE_MAX || oldTo == SIZE_MAX || !hasEdge(oldGraph, oldFrom, oldTo))
+                    diff.addedEdges.emplace_back(node, successor);
+            }
+        }
+        for (size_t node = 0; node < oldGraph.size(); ++node) {
+            for (size_t successor : oldGraph.successors(node)) {
+                const size_t newFrom = diff.oldToNew[node];
+                const size_t newTo = diff.oldToNew[successor];
+                if (newFrom == SIZE_MAX || newTo == SIZE_MAX || !hasEdge(newGraph, newFrom, newTo))
+                    diff.removedEdges.emplace_back(node, successor);
+            }
+        }
+
+        return diff;
+    }
+};
+
+// Also reports the hazards that appeared or went away, e.g. for barriers cached per hazard
+template <typename TDependencyType>
+struct TRWGraphDiff : TGraphDiff {
+    using Hazard = THazard<TDependencyType>;
+
+    // Hazards in new ids
+    std::vector<Hazard> addedHazards;
+    // Hazards in old ids
+    std::vector<Hazard> removedHazards;
+
+    bool empty() const {
+        return TGraphDiff::empty() && addedHazards.empty() && removedHazards.empty();
+    }
+
+    // 'nodeHash' is the same as for TStructuralHashes::compute
+    template <typename TType, typename TTopologicalSorter, typename TNodeHash>
+    static TRWGraphDiff compute(const TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>& oldGraph, const TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>& newGraph, TNodeHash&& nodeHash) {
+        using TGraph = TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>;
+
+        TRWGraphDiff diff;
+        static_cast<TGraphDiff&>(diff) = TGraphDiff::compute(oldGraph.compile(), TStructuralHashes::compute(oldGraph, nodeHash), newGraph.compile(), TStructuralHashes::compute(newGraph, nodeHash));
+
+        struct HazardHasher {
+            size_t operator()(const Hazard& hazard) const {
+                uint64_t hash = TStructuralHashes::combine(TStructuralHashes::mix(hazard.from), hazard.to);
+                hash = TStructuralHashes::combine(hash, static_cast<uint64_t>(typename TGraph::Hasher{}(hazard.resource)));
+                return static_cast<size_t>(TStructuralHashes::combine(hash, hazard.type));
+            }
+        };
+        struct HazardEqual {
+            bool operator()(const Hazard& a, const Hazard& b) const {
+                return a.from == b.from && a.to == b.to && a.type == b.type && a.resource == b.resource;
+            }
+        };
+
+        // Old hazards between matched nodes, moved into new ids
+        const std::vector<Hazard> oldHazards = oldGraph.computeHazards();
+        std::unordered_set<Hazard, HazardHasher, HazardEqual> matchedOld;
+        for (const Hazard& hazard : oldHazards) {
+            const size_t from = diff.oldToNew[hazard.from];
+            const size_t to = diff.oldToNew[hazard.to];
+            if (from != SIZE_MAX && to != SIZE_MAX)
+                matchedOld.insert(Hazard{from, to, hazard.resource, hazard.type});
+        }
+
+        std::unordered_set<Hazard, HazardHasher, HazardEqual> current;
+        for (const Hazard& hazard : newGraph.computeHazards()) {
+            current.insert(hazard);
+            if (matchedOld.find(hazard) == matchedOld.end())
+                diff.addedHazards.push_back(hazard);
+        }
+
+        for (const Hazard& hazard : oldHazards) {
+            const size_t from = diff.oldToNew[hazard.from];
+            const size_t to = diff.oldToNew[hazard.to];
+            if (from == SIZE_MAX || to == SIZE_MAX || current.find(Hazard{from, to, hazard.resource, hazard.type}) == current.end())
+                diff.removedHazards.push_back(hazard);
+        }
+
+        return diff;
+    }
+};
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include "DependencyGraph.h"
+
+// Explains why a graph has no width, by finding the false hazards (WAR and WAW) that serialize passes
+// A false hazard goes away when the resource is versioned, i.e. the writer gets a fresh copy instead of reusing it
+// Findings are ranked by how many passes shorter the critical path gets once they are resolved
+// Only findings that every critical chain runs through can shorten it, the most promising of those are measured exactly
+// by finding the longest chain again without them, the rest get an upper bound from the chains around them
+template <typename TDependencyType>
+struct TGraphLints {
+
+    struct Finding {
+        enum Kind {
+            // An edge that only exists because of false hazards
+            FALSE_HAZARD,
+            // A resource responsible for a large share of all edges
+            HOT_RESOURCE,
+            // A pass that only waits on false hazards, versioning would let it start right away
+            FALSE_ONLY_DEPENDENCY
+        };
+
+        Kind kind;
+        // The edge for FALSE_HAZARD, the pass in 'to' for FALSE_ONLY_DEPENDENCY, SIZE_MAX otherwise
+        size_t from = SIZE_MAX;
+        size_t to = SIZE_MAX;
+        // Resources to version to resolve the finding
+        std::vector<TDependencyType> resources;
+        // Edges the resource takes part in, for HOT_RESOURCE
+        size_t edgeCount = 0;
+        size_t criticalPathGain = 0;
+        // False if 'criticalPathGain' is only an upper bound
+        bool exact = true;
+    };
+
+    // Passes on the longest chain of the graph
+    size_t criticalPath = 0;
+    std::vector<Finding> findings;
+
+    // A resource is hot once it takes part in more than 'hotShare' of all edges
+    // Each exact evaluation walks the whole graph, hot resources are always evaluated exactly, as there are few of them
+    template <typename TType, typename TTopologicalSorter>
+    static TGraphLints compute(const TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>& graph, const double hotShare = 0.25, const size_t maxExactEvaluations = 64) {
+        using TGraph = TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>;
+        using Hazard = THazard<TDependencyType>;
+        const TCompiledGraph compiled = graph.compile();
+
+        // Why each compiled edge exists, by its index in 'targets'
+        struct EdgeReasons {
+            bool required = false;
+            std::vector<TDependencyType> falseResources;
+        };
+        std::vector<EdgeReasons> reasons(compiled.edgeCount());
+        const auto edgeIndex = [&](const size_t from, const size_t to) {
+            const auto successors = compiled.successors(from);
+            const size_t* found = std::lower_bound(successors.begin(), successors.end(), to);
+            return found != successors.end() && *found == to ? static_cast<size_t>(found - compiled.targets.data()) : SIZE_MAX;
+        };
+
+        std::vector<std::pair<TDependencyType, std::vector<size_t>>> resourceEdges;
+        std::unordered_map<TDependencyType, size_t, typename TGraph::Hasher> resourceIndices;
+        for (const Hazard& hazard : graph.computeHazards()) {
+            const size_t edge = edgeIndex(hazard.from, hazard.to);
+            if (edge == SIZE_MAX)
+                continue;
+
+            // Temporal resources are versioned already, what orders their readers before the writer flips them costs nothing
+            if (hazard.type == Hazard::RAW || graph.getResourceKind(hazard.resource) == TGraph::TEMPORAL)
+                reasons[edge].required = true;
+            else if (std::find(reasons[edge].falseResources.begin(), reasons[edge].falseResources.end(), hazard.resource) == reasons[edge].falseResources.end())
+                reasons[edge].falseResources.push_back(hazard.resource);
+
+            const auto [entry, inserted] = resourceIndices.emplace(hazard.resource, resourceEdges.size());
+            if (inserted)
+                resourceEdges.emplace_back(hazard.resource, std::vector<size_t>{});
+            auto& edges = resourceEdges[entry->second].second;
+            if (edges.empty() || edges.back() != edge)
+                edges.push_back(edge);
+        }
+        for (const auto& [node, dependency] : graph.getExplicitDependencies()) {
+            const size_t edge = edgeIndex(node, dependency);
+            if (edge != SIZE_MAX)
+                reasons[edge].required = true;
+        }
+        const auto isFalse = [&](const size_t edge) { return !reasons[edge].required && !reasons[edge].falseResources.empty(); };
+
+        // Longest chain in passes, ignoring the edges in 'skipped'
+        const std::vector<size_t> order = TKahnTopologicalSort{}(compiled);
+        std::vector<size_t> head(compiled.size());
+        std::vector<bool> skipped(compiled.edgeCount(), false);
+        const auto longestChain = [&]() {
+            size_t longest = 0;
+            std::fill(head.begin(), head.end(), 1);
+            for (size_t node : order) {
+                longest = std::max(longest, head[node]);
+                for (size_t edge = compiled.offsets[node]; edge < compiled.offsets[node + 1]; ++edge)
+                    if (!skipped[edge])
+                        head[compiled.targets[edge]] = std::max(head[compiled.targets[edge]], head[node] + 1);
+            }
+            return longest;
+        };
+
+        TGraphLints lints;
+        lints.criticalPath = longestChain();
+
+        // Longest chain ending and starting at each pass, only edges on a critical chain can shorten it
+        const std::vector<size_t> chainTo = head;
+        std::vector<size_t> chainFrom(compiled.size(), 1);
+        for (auto node = order.rbegin(); node != order.rend(); ++node)
+            for (size_t successor : compiled.successors(*node))
+                chainFrom[*node] = std::max(chainFrom[*node], chainFrom[successor] + 1);
+
+        const auto gainWithout = [&](const std::vector<size_t>& edges) {
+            for (size_t edge : edges)
+                skipped[edge] = true;
+            const size_t length = longestChain();
+            for (size_t edge : edges)
+                skipped[edge] = false;
+            return lints.criticalPath - length;
+        };
+
+        // Critical chains ending and starting at each pass, counted modulo a prime so they never overflow
+        // Whatever fewer than all critical chains run through can not shorten the critical path
+        const uint64_t prime = 2147483647ull;
+        std::vector<uint64_t> countTo(compiled.size(), 0);
+        std::vector<uint64_t> countFrom(compiled.size(), 0);
+        uint64_t criticalChains = 0;
+        for (size_t node : order) {
+            countTo[node] = chainTo[node] == 1 ? 1 : 0;
+            for (size_t predecessor : compiled.predecessors(node))
+                if (chainTo[predecessor] + 1 == chainTo[node])
+                    countTo[node] = (countTo[node] + countTo[predecessor]) % prime;
+            if (chainTo[node] == lints.criticalPath)
+                criticalChains = (criticalChains + countTo[node]) % prime;
+        }
+        for (auto node = order.rbegin(); node != order.rend(); ++node) {
+            countFrom[*node] = chainFrom[*node] == 1 ? 1 : 0;
+            for (size_t successor : compiled.successors(*node))
+                if (chainFrom[successor] + 1 == chainFrom[*node])
+                    countFrom[*node] = (countFrom[*node] + countFrom[successor]) % prime;
+        }
+
+        // The two longest chains into each pass and out of it, with the neighbour the longest one runs through
+        // so the longest chain avoiding any one neighbour is known without walking the others again
+        struct TLongest {
+            size_t first = 0;
+            size_t through = SIZE_MAX;
+            size_t second = 0;
+
+            void add(const size_t length, const size_t neighbour) {
+                if (length > first) {
+                    second = first;
+                    first = length;
+                    through = neighbour;
+                } else if (length > second) {
+                    second = length;
+                }
+            }
+
+            size_t except(const size_t neighbour) const {
+                return neighbour == through ? second : first;
+            }
+        };
+        std::vector<TLongest> longestTo(compiled.size());
+        std::vector<TLongest> longestFrom(compiled.size());
+        for (size_t node = 0; node < compiled.size(); ++node) {
+            for (size_t predecessor : compiled.predecessors(node))
+                longestTo[node].add(chainTo[predecessor], predecessor);
+            for (size_t successor : compiled.successors(node))
+                longestFrom[node].add(chainFrom[successor], successor);
+        }
+
+        // Findings every critical chain runs through, with what they remove
+        std::vector<std::pair<size_t, std::vector<size_t>>> candidates;
+
+        for (size_t node = 0; node < compiled.size(); ++node) {
+            for (size_t edge = compiled.offsets[node]; edge < compiled.offsets[node + 1]; ++edge) {
+                if (!isFalse(edge))
+                    continue;
+
+                const size_t to = compiled.targets[edge];
+                Finding finding{Finding::FALSE_HAZARD, node, to, reasons[edge].falseResources};
+                if (chainTo[node] + chainFrom[to] == lints.criticalPath && countTo[node] * countFrom[to] % prime == criticalChains) {
+                    // Without the edge, chains still run into 'to' from elsewhere and out of 'node' to elsewhere
+                    const size_t through = std::max(longestTo[to].except(node) + chainFrom[to], chainTo[node] + longestFrom[node].except(to));
+                    finding.criticalPathGain = lints.criticalPath - through;
+                    candidates.emplace_back(lints.findings.size(), std::vector<size_t>{edge});
+                }
+                lints.findings.push_back(std::move(finding));
+            }
+        }
+
+        for (const auto& [resource, edges] : resourceEdges) {
+            if (static_cast<double>(edges.size()) <= hotShare * static_cast<double>(compiled.edgeCount()))
+                continue;
+
+            // Versioning the resource only removes the edges no other resource needs
+            std::vector<size_t> removable;
+            for (size_t edge : edges)
+                if (isFalse(edge) && reasons[edge].falseResources.size() == 1)
+                    removable.push_back(edge);
+
+            Finding finding{Finding::HOT_RESOURCE, SIZE_MAX, SIZE_MAX, {resource}};
+            finding.edgeCount = edges.size();
+            finding.criticalPathGain = removable.empty() ? 0 : gainWithout(removable);
+            lints.findings.push_back(std::move(finding));
+        }
+
+        for (size_t node = 0; node < compiled.size(); ++node) {
+            const auto predecessors = compiled.predecessors(node);
+            if (predecessors.empty())
+                continue;
+
+            std::vector<size_t> edges;
+            Finding finding{Finding::FALSE_ONLY_DEPENDENCY, SIZE_MAX, node, {}};
+            for (size_t predecessor : predecessors) {
+                const size_t edge = edgeIndex(predecessor, node);
+                if (!isFalse(edge))
+                    break;
+                edges.push_back(edge);
+                for (const auto& resource : reasons[edge].falseResources)
+                    if (std::find(finding.resources.begin(), finding.resources.end(), resource) == finding.resources.end())
+                        finding.resources.push_back(resource);
+            }
+            if (edges.size() != predecessors.size())
+                continue;
+
+            if (chainTo[node] + chainFrom[node] - 1 == lints.criticalPath && countTo[node] * countFrom[node] % prime == criticalChains) {
+                // Without its predecessors the pass starts a chain of its own
+                finding.criticalPathGain = lints.criticalPath - chainFrom[node];
+                candidates.emplace_back(lints.findings.size(), std::move(edges));
+            }
+            lints.findings.push_back(std::move(finding));
+        }
+
+        // The bounds are upper bounds, so measuring the largest ones first finds the findings that really rank highest
+        std::stable_sort(candidates.begin(), candidates.end(), [&](const auto& a, const auto& b) {
+            return lints.findings[a.first].criticalPathGain > lints.findings[b.first].criticalPathGain;
+        });
+        for (size_t index = 0; index < candidates.size(); ++index) {
+            Finding& finding = lints.findings[candidates[index].first];
+            if (index < maxExactEvaluations && finding.criticalPathGain > 0)
+                finding.criticalPathGain = gainWithout(candidates[index].second);
+            else
+                finding.exact = finding.criticalPathGain == 0;
+        }
+
+        std::stable_sort(lints.findings.begin(), lints.findings.end(), [](const Finding& a, const Finding& b) {
+            return a.criticalPathGain > b.criticalPathGain;
+        });
+        return lints;
+    }
+};
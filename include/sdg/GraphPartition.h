@@ -0,0 +1,98 @@
+#pragma once
+
+#include "DependencyGraph.h"
+
+struct TGraphPartition {
+    // The part each node was assigned to
+    std::vector<size_t> parts;
+    // The summed cost of the nodes in each part
+    std::vector<double> costs;
+    // Edges whose ends are in different parts, each one is a message between processes
+    size_t cutEdges = 0;
+};
+
+// Splits a compiled graph into balanced parts while keeping as many edges as possible inside a part
+// Starts from contiguous slices of a topological order, then greedily moves nodes towards the part most of their neighbours are in
+struct TGraphPartitioner {
+
+    // How far above the average cost a part may grow when refining
+    double imbalance = 0.05;
+    size_t refinementPasses = 8;
+
+    // 'costs' is the cost of each node, when empty every node costs 1
+    TGraphPartition operator()(const TCompiledGraph& graph, const size_t partCount, const std::vector<double>& costs = {}) const {
+        if (partCount == 0)
+            throw std::invalid_argument("Cannot partition a graph into 0 parts!");
+
+        const auto cost = [&](const size_t node) { return costs.empty() ? 1.0 : costs[node]; };
+
+        TGraphPartition partition;
+        partition.parts.assign(graph.size(), 0);
+        partition.costs.assign(partCount, 0.0);
+
+        double totalCost = 0.0;
+        for (size_t node = 0; node < graph.size(); ++node)
+            if (!graph.isRemoved(node))
+                totalCost += cost(node);
+        const double averageCost = totalCost / static_cast<double>(partCount);
+        const double maxCost = averageCost * (1.0 + imbalance);
+
+        // Slicing a topological order keeps chains together, so most edges start out inside a part
+        size_t part = 0;
+        for (size_t node : TKahnTopologicalSort{}(graph)) {
+            if (part + 1 < partCount && partition.costs[part] + cost(node) / 2 > averageCost)
+                ++part;
+            partition.parts[node] = part;
+            partition.costs[part] += cost(node);
+        }
+
+        std::vector<size_t> neighbourCount(partCount, 0);
+        std::vector<size_t> touched;
+
+        for (size_t pass = 0; pass < refinementPasses; ++pass) {
+            bool moved = false;
+
+            for (size_t node = 0; node < graph.size(); ++node) {
+                touched.clear();
+                const auto count = [&](const size_t neighbour) {
+                    const size_t neighbourPart = partition.parts[neighbour];
+                    if (neighbourCount[neighbourPart]++ == 0)
+                        touched.push_back(neighbourPart);
+                };
+                for (size_t to : graph.successors(node))
+                    count(to);
+                for (size_t from : graph.predecessors(node))
+                    count(from);
+
+                // Moving to another part cuts the edges to the current part and uncuts the ones to the new part
+                const size_t from = partition.parts[node];
+                size_t best = from;
+                for (size_t candidate : touched)
+                    if (neighbourCount[candidate] > neighbourCount[best] && partition.costs[candidate] + cost(node) <= maxCost)
+                        best = candidate;
+
+                for (size_t candidate : touched)
+                    neighbourCount[candidate] = 0;
+                neighbourCount[from] = 0;
+
+                if (best == from)
+                    continue;
+
+                partition.parts[node] = best;
+                partition.costs[from] -= cost(node);
+                partition.costs[best] += cost(node);
+                moved = true;
+            }
+
+            if (!moved)
+                break;
+        }
+
+        for (size_t node = 0; node < graph.size(); ++node)
+            for (size_t to : graph.successors(node))
+                if (partition.parts[node] != partition.parts[to])
+                    ++partition.cutEdges;
+
+        return partition;
+    }
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+
+#include "DependencyGraph.h"
+
+// Records nodes and accesses without touching a shared graph, so each thread can declare its passes on its own recorder
+// Recorders are merged into one graph afterwards, ordered by the sequence key of each node instead of by timing,
+// which makes the merged graph identical no matter how the threads were scheduled
+template <typename TType, typename TDependencyType>
+struct TGraphRecorder {
+
+    // Returns an id local to this recorder
+    template <typename... TArgs>
+    size_t addNode(const uint64_t sequence, TArgs&&... args) {
+        const size_t nodeId = nodes.size();
+        nodes.emplace_back(std::forward<TArgs>(args)...);
+        sequences.push_back(sequence);
+        return nodeId;
+    }
+
+    void addRead(const size_t node, const TDependencyType dependency) {
+        accesses.push_back(Access{node, dependency, false});
+    }
+
+    void addWrite(const size_t node, const TDependencyType dependency) {
+        accesses.push_back(Access{node, dependency, true});
+    }
+
+    // Both nodes are local to this recorder, 'dependency' will run after 'node'
+    void addDependency(const size_t node, const size_t dependency) {
+        dependencies.emplace_back(node, dependency);
+    }
+
+    size_t size() const { return nodes.size(); }
+
+    void clear() {
+        nodes.clear();
+        sequences.clear();
+        accesses.clear();
+        dependencies.clear();
+    }
+
+    // Appends every recorded node to 'graph' ordered by sequence, ties keep recorder order and then recording order
+    // Returns, for each recorder, the id each of its local nodes got in 'graph'
+    template <typename TTopologicalSorter>
+    static std::vector<std::vector<size_t>> merge(TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>& graph, const std::vector<TGraphRecorder*>& recorders) {
+        struct Entry {
+            uint64_t sequence;
+            size_t recorder;
+            size_t node;
+        };
+
+        std::vector<Entry> entries;
+        std::vector<std::vector<size_t>> ids(recorders.size());
+        for (size_t recorder = 0; recorder < recorders.size(); ++recorder) {
+            ids[recorder].resize(recorders[recorder]->size());
+            for (size_t node = 0; node < recorders[recorder]->size(); ++node)
+                entries.push_back(Entry{recorders[recorder]->sequences[node], recorder, node});
+        }
+
+        // Entries are already in recorder then recording order, so a stable sort settles every tie the same way
+        std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return a.sequence < b.sequence;
+        });
+
+        for (const Entry& entry : entries)
+            ids[entry.recorder][entry.node] = graph.addNode(std::move(recorders[entry.recorder]->nodes[entry.node]));
+
+        // Accesses are added in merged node order, so the graph can keep resolving hazards as they arrive
+        struct MergedAccess {
+            size_t node;
+            const Access* access;
+        };
+
+        std::vector<MergedAccess> merged;
+        for (size_t recorder = 0; recorder < recorders.size(); ++recorder)
+            for (const Access& access : recorders[recorder]->accesses)
+                merged.push_back(MergedAccess{ids[recorder][access.node], &access});
+
+        std::stable_sort(merged.begin(), merged.end(), [](const MergedAccess& a, const MergedAccess& b) {
+            return a.node < b.node;
+        });
+
+        for (const MergedAccess& entry : merged) {
+            if (entry.access->write)
+                graph.addWrite(entry.node, entry.access->resource);
+            else
+                graph.addRead(entry.node, entry.access->resource);
+        }
+
+        for (size_t recorder = 0; recorder < recorders.size(); ++recorder) {
+            for (const auto& [node, dependency] : recorders[recorder]->dependencies)
+                graph.addDependency(ids[recorder][node], ids[recorder][dependency]);
+            recorders[recorder]->clear();
+        }
+
+        return ids;
+    }
+
+private:
+
+    struct Access {
+        size_t node;
+        TDependencyType resource;
+        bool write;
+    };
+
+    std::vector<TType> nodes;
+    std::vector<uint64_t> sequences;
+    std::vector<Access> accesses;
+    std::vector<std::pair<size_t, size_t>> dependencies;
+};
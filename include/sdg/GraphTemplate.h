@@ -0,0 +1,119 @@
+#pragma once
+
+#include "DependencyGraph.h"
+
+// A compiled read/write subgraph that can be stamped into another graph many times
+// Hazards inside the template are solved once, each instance only copies the edges with an offset
+// and replays, once per resource, the few accesses that can order it against the rest of the graph
+// The other accesses are still stored on every instance, so anything reading the accesses of the graph sees all of them
+template <typename TType, typename TDependencyType>
+struct TRWGraphTemplate {
+
+    struct Access {
+        size_t node;
+        // Index into 'resources'
+        size_t resource;
+        bool write;
+    };
+
+    template <typename TTopologicalSorter>
+    static TRWGraphTemplate compile(const TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>& graph) {
+        using TGraph = TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>;
+
+        if (graph.removedCount() > 0)
+            throw std::invalid_argument("Compact the graph before compiling it into a template!");
+
+        TRWGraphTemplate result;
+        result.graph = graph.compile();
+        result.explicitDependencies = graph.getExplicitDependencies();
+        result.nodes.reserve(graph.size());
+        for (size_t node = 0; node < graph.size(); ++node)
+            result.nodes.push_back(graph.getNode(node));
+
+        // Per resource, only the reads before the first write, the first write, the last write and the reads after it
+        // can have an edge to a pass outside of the template, everything in between is ordered by the template itself
+        std::unordered_map<TDependencyType, size_t, typename TGraph::Hasher> resourceIndices;
+        for (size_t node = 0; node < graph.size(); ++node) {
+            const auto accesses = graph.dependencies.find(node);
+            if (accesses == graph.dependencies.end())
+                continue;
+
+            for (const auto& access : accesses->second) {
+                const bool write = access.type == TGraph::Access::WRITE;
+                const auto [resource, inserted] = resourceIndices.try_emplace(access.node, result.resources.size());
+                if (inserted) {
+                    result.resources.push_back(access.node);
+                    result.boundaries.emplace_back();
+                }
+
+                result.accesses.push_back(Access{node, resource->second, write});
+                result.boundaries[resource->second].access(node, write);
+            }
+        }
+
+        return result;
+    }
+
+    // Adds one copy of the template to 'graph', 'remap' maps each template resource to the resource of this instance
+    // Returns the id of the first node, template node i becomes node (first + i)
+    // A remap that maps two template resources to the same one adds hazards the template never saw, every access is analyzed then
+    template <typename TTopologicalSorter, typename TRemap>
+    size_t instantiate(TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>& graph, TRemap&& remap) const {
+        using TGraph = TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>;
+
+        const size_t first = graph.size();
+        for (const auto& node : nodes)
+            graph.addNode(node);
+
+        // Distinct hashes prove the remap kept resources apart, only equal hashes have to compare the resources
+        const typename TGraph::Hasher hasher;
+        std::vector<TDependencyType> instanceResources;
+        std::vector<size_t> hashes;
+        instanceResources.reserve(resources.size());
+        hashes.reserve(resources.size());
+        for (const auto& resource : resources) {
+            instanceResources.push_back(remap(resource));
+            hashes.push_back(hasher(instanceResources.back()));
+        }
+        std::sort(hashes.begin(), hashes.end());
+        bool distinct = std::adjacent_find(hashes.begin(), hashes.end()) == hashes.end();
+        if (!distinct) {
+            std::unordered_set<TDependencyType, typename TGraph::Hasher> unique(instanceResources.begin(), instanceResources.end());
+            distinct = unique.size() == instanceResources.size();
+        }
+
+        if (distinct) {
+            graph.addSolvedPasses(first, this->graph, [&](auto&& visit) {
+                for (const auto& access : accesses)
+                    visit(first + access.node, instanceResources[access.resource], access.write);
+            }, [&](auto&& visit) {
+                for (size_t resource = 0; resource < resources.size(); ++resource)
+                    visit(instanceResources[resource], boundaries[resource]);
+            });
+        } else {
+            for (const auto& access : accesses) {
+                if (access.write)
+                    graph.addWrite(first + access.node, instanceResources[access.resource]);
+                else
+                    graph.addRead(first + access.node, instanceResources[access.resource]);
+            }
+        }
+
+        for (const auto& [node, dependency] : explicitDependencies)
+            graph.addDependency(first + node, first + dependency);
+
+        return first;
+    }
+
+    size_t size() const { return nodes.size(); }
+
+    // Hazards and explicit dependencies of the template
+    TCompiledGraph graph;
+    std::vector<TType> nodes;
+    std::vector<std::pair<size_t, size_t>> explicitDependencies;
+    // Every resource the template accesses, in the order it is first accessed, with the accesses that can order it against other passes
+    std::vector<TDependencyType> resources;
+    std::vector<TResourceBoundary> boundaries;
+    // Every access in declaration order
+    std::vector<Access> accesses;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <memory>
+
+#include "DependencyGraph.h"
+
+template <typename TType>
+struct TNestedGraph;
+
+// Either a single node or a whole compiled graph, the outer graph sorts both as one node
+template <typename TType>
+struct TNestedNode {
+
+    TNestedNode(const TType& value): value(value) {}
+    TNestedNode(std::shared_ptr<const TNestedGraph<TType>> subgraph): subgraph(std::move(subgraph)) {}
+
+    bool isSubgraph() const { return subgraph != nullptr; }
+
+    TType value{};
+    std::shared_ptr<const TNestedGraph<TType>> subgraph;
+};
+
+// A flat graph with every subgraph replaced by its nodes, ready to be executed in parallel
+template <typename TType>
+struct TExpandedGraph {
+    TCompiledGraph graph;
+    std::vector<TType> nodes;
+};
+
+// A compiled graph of nested nodes, it is immutable so outer graphs can share it without ever recompiling it
+template <typename TType>
+struct TNestedGraph {
+
+    template <typename TTopologicalSorter>
+    static std::shared_ptr<const TNestedGraph> compile(const TDependencyGraph<TNestedNode<TType>, TTopologicalSorter>& graph) {
+        if (graph.size() == 0)
+            throw std::invalid_argument("Cannot nest an empty dependency graph!");
+
+        auto result = std::make_shared<TNestedGraph>();
+        result->graph = graph.compile();
+        result->nodes.reserve(graph.size());
+        for (size_t node = 0; node < graph.size(); ++node)
+            result->nodes.push_back(graph.getNode(node));
+        return result;
+    }
+
+    // Replaces each subgraph node with its own nodes, recursively
+    // An edge into a subgraph waits on its sources, and an edge out of it waits on its sinks
+    TExpandedGraph<TType> expand() const {
+        TExpandedGraph<TType> result;
+        std::vector<std::pair<size_t, size_t>> edges;
+        std::vector<size_t> sources, sinks;
+        expandInto(result.nodes, edges, sources, sinks);
+        result.graph = TCompiledGraph::fromEdges(result.nodes.size(), edges);
+        return result;
+    }
+
+    TCompiledGraph graph;
+    std::vector<TNestedNode<TType>> nodes;
+
+private:
+
+    void expandInto(std::vector<TType>& leaves, std::vector<std::pair<size_t, size_t>>& edges, std::vector<size_t>& sources, std::vector<size_t>& sinks) const {
+        std::vector<std::vector<size_t>> nodeSources(nodes.size()), nodeSinks(nodes.size());
+
+        for (size_t node = 0; node < nodes.size(); ++node) {
+            if (graph.isRemoved(node)) {
+                continue;
+            } else if (nodes[node].isSubgraph()) {
+                nodes[node].subgraph->expandInto(leaves, edges, nodeSources[node], nodeSinks[node]);
+            } else {
+                nodeSources[node].push_back(leaves.size());
+                nodeSinks[node].push_back(leaves.size());
+                leaves.push_back(nodes[node].value);
+            }
+        }
+
+        for (size_t node = 0; node < nodes.size(); ++node) {
+            for (size_t dependency : graph.successors(node))
+                for (size_t from : nodeSinks[node])
+                    for (size_t to : nodeSources[dependency])
+                        edges.emplace_back(from, to);
+
+            if (graph.inDegree[node] == 0)
+                sources.insert(sources.end(), nodeSources[node].begin(), nodeSources[node].end());
+            if (graph.successors(node).empty())
+                sinks.insert(sinks.end(), nodeSinks[node].begin(), nodeSinks[node].end());
+        }
+    }
+};
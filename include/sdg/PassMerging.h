@@ -0,0 +1,112 @@
+#pragma once
+
+#include "DependencyGraph.h"
+
+// Adjacent passes of an order that hand a resource from one to the next, which can run as subpasses of one render pass
+// The handed over resources stay on chip between them, so writing them out and reading them back is saved
+template <typename TDependencyType>
+struct TPassGroup {
+    // In the order they run
+    std::vector<size_t> passes;
+    // Written by a pass of the group and accessed by a later one of it
+    std::vector<TDependencyType> attachments;
+    // Attachments nothing outside the group accesses, they never have to leave the chip at all
+    std::vector<TDependencyType> internalAttachments;
+};
+
+// Groups every run of adjacent passes in 'order' where each pass accesses something the pass before it wrote
+// 'canMerge(previous, pass)' can keep passes apart that the backend cannot merge, e.g. because their resolution differs
+// Only groups of at least two passes are returned
+template <typename TType, typename TDependencyType, typename TTopologicalSorter, typename TCanMerge>
+std::vector<TPassGroup<TDependencyType>> findMergeablePasses(const TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>& graph, const std::vector<size_t>& order, TCanMerge&& canMerge) {
+    using TGraph = TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>;
+    using Access = typename TGraph::Access;
+
+    static const std::vector<Access> noAccesses;
+    const auto accessesOf = [&](const size_t node) -> const std::vector<Access>& {
+        const auto accesses = graph.dependencies.find(node);
+        return accesses == graph.dependencies.end() ? noAccesses : accesses->second;
+    };
+
+    // Passes accessing each resource, to tell internal attachments apart
+    std::unordered_map<TDependencyType, size_t, typename TGraph::Hasher> accessCounts;
+    for (size_t node : order) {
+        std::vector<TDependencyType> seen;
+        for (const Access& access : accessesOf(node)) {
+            if (std::find(seen.begin(), seen.end(), access.node) == seen.end()) {
+                seen.push_back(access.node);
+                ++accessCounts[access.node];
+            }
+        }
+    }
+
+    // How the passes of the current group use each resource, in the order the group first touched them
+    struct Usage {
+        size_t passes = 0;
+        bool written = false;
+        bool handedOver = false;
+    };
+    std::unordered_map<TDependencyType, Usage, typename TGraph::Hasher> usages;
+    std::vector<TDependencyType> touched;
+
+    std::vector<TPassGroup<TDependencyType>> groups;
+    TPassGroup<TDependencyType> group;
+
+    const auto close = [&]() {
+        if (group.passes.size() > 1) {
+            for (const auto& resource : touched) {
+                const Usage& usage = usages[resource];
+                if (!usage.handedOver)
+                    continue;
+                group.attachments.push_back(resource);
+                if (accessCounts[resource] == usage.passes && graph.getResourceKind(resource) == TGraph::TRANSIENT)
+                    group.internalAttachments.push_back(resource);
+            }
+            groups.push_back(std::move(group));
+        }
+        group = TPassGroup<TDependencyType>{};
+        usages.clear();
+        touched.clear();
+    };
+
+    for (size_t pass : order) {
+        const auto& accesses = accessesOf(pass);
+
+        if (!group.passes.empty()) {
+            const size_t previous = group.passes.back();
+            bool handedOver = false;
+            for (const Access& previousAccess : accessesOf(previous))
+                if (previousAccess.type == Access::WRITE)
+                    for (const Access& access : accesses)
+                        handedOver = handedOver || previousAccess.node == access.node;
+
+            if (!handedOver || !canMerge(previous, pass))
+                close();
+        }
+        group.passes.push_back(pass);
+
+        // Anything written by an earlier pass of the group and accessed now is handed over on chip
+        std::vector<TDependencyType> seen;
+        for (const Access& access : accesses) {
+            const auto [usage, inserted] = usages.try_emplace(access.node);
+            if (inserted)
+                touched.push_back(access.node);
+            if (std::find(seen.begin(), seen.end(), access.node) == seen.end()) {
+                seen.push_back(access.node);
+                ++usage->second.passes;
+                usage->second.handedOver = usage->second.handedOver || usage->second.written;
+            }
+        }
+        for (const Access& access : accesses)
+            if (access.type == Access::WRITE)
+                usages[access.node].written = true;
+    }
+    close();
+
+    return groups;
+}
+
+template <typename TType, typename TDependencyType, typename TTopologicalSorter>
+std::vector<TPassGroup<TDependencyType>> findMergeablePasses(const TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>& graph, const std::vector<size_t>& order) {
+    return findMergeablePasses(graph, order, [](size_t, size_t) { return true; });
+}
@@ -0,0 +1,260 @@
+#pragma once
+
+#include "GraphPartition.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Local stand-in for a network transport, each part owns a pipe that carries the ids of finished nodes
+// Every message is a single node id, which is smaller than PIPE_BUF so concurrent writers never interleave
+struct TPipeTransport {
+
+    TPipeTransport() = default;
+    TPipeTransport(const TPipeTransport&) = delete;
+    TPipeTransport& operator=(const TPipeTransport&) = delete;
+
+    ~TPipeTransport() { close(); }
+
+    void open(const size_t partCount) {
+        close();
+        readEnds.assign(partCount, -1);
+        writeEnds.assign(partCount, -1);
+        for (size_t part = 0; part < partCount; ++part) {
+            int ends[2];
+            if (::pipe(ends) != 0)
+                throw std::runtime_error(std::string("Could not create pipe: ") + std::strerror(errno));
+            ::fcntl(ends[0], F_SETFL, ::fcntl(ends[0], F_GETFL) | O_NONBLOCK);
+            ::fcntl(ends[1], F_SETFL, ::fcntl(ends[1], F_GETFL) | O_NONBLOCK);
+            readEnds[part] = ends[0];
+            writeEnds[part] = ends[1];
+        }
+    }
+
+    // Called in the process that runs 'part', it only keeps its own inbox and the other parts' outboxes
+    void bind(const size_t part) {
+        self = part;
+        for (size_t other = 0; other < readEnds.size(); ++other)
+            if (other != part)
+                closeEnd(readEnds[other]);
+        // Without our own write end, reading hits end of file once every other part is gone
+        closeEnd(writeEnds[part]);
+    }
+
+    void close() {
+        for (int& end : readEnds)
+            closeEnd(end);
+        for (int& end : writeEnds)
+            closeEnd(end);
+    }
+
+    // When the other inbox is full, ours is drained into 'received' while waiting, so two parts never wait on each other
+    void send(const size_t part, const size_t node, std::vector<size_t>& received) {
+        while (true) {
+            const ssize_t written = ::write(writeEnds[part], &node, sizeof(node));
+            if (written == static_cast<ssize_t>(sizeof(node)))
+                return;
+            if (written < 0 && errno != EAGAIN && errno != EINTR)
+                throw std::runtime_error(std::string("Could not send completion: ") + std::strerror(errno));
+
+            pollfd fds[2] = {{writeEnds[part], POLLOUT, 0}, {readEnds[self], POLLIN, 0}};
+            ::poll(fds, 2, -1);
+            if (fds[1].revents & POLLIN)
+                drain(received);
+        }
+    }
+
+    // Blocks until at least one node id arrived
+    void receive(std::vector<size_t>& received) {
+        const size_t before = received.size();
+        while (received.size() == before) {
+            pollfd fd{readEnds[self], POLLIN, 0};
+            if (::poll(&fd, 1, -1) < 0 && errno != EINTR)
+                throw std::runtime_error(std::string("Could not wait for completions: ") + std::strerror(errno));
+            if (!drain(received) && received.size() == before)
+                throw std::runtime_error("Every other part exited before sending its completions!");
+        }
+    }
+
+private:
+
+    // Returns false on end of file
+    bool drain(std::vector<size_t>& received) {
+        unsigned char buffer[4096];
+        while (true) {
+            const ssize_t count = ::read(readEnds[self], buffer, sizeof(buffer));
+            if (count == 0)
+                return false;
+            if (count < 0)
+                return errno == EAGAIN || errno == EINTR;
+
+            partial.insert(partial.end(), buffer, buffer + count);
+            const size_t whole = partial.size() / sizeof(size_t);
+            for (size_t i = 0; i < whole; ++i) {
+                size_t node;
+                std::memcpy(&node, partial.data() + i * sizeof(size_t), sizeof(size_t));
+                received.push_back(node);
+            }
+            partial.erase(partial.begin(), partial.begin() + static_cast<std::ptrdiff_t>(whole * sizeof(size_t)));
+        }
+    }
+
+    static void closeEnd(int& end) {
+        if (end >= 0)
+            ::close(end);
+        end = -1;
+    }
+
+    std::vector<int> readEnds;
+    std::vector<int> writeEnds;
+    std::vector<unsigned char> partial;
+    size_t self = 0;
+};
+
+// Runs each part of a partitioned graph in its own child process
+// A node only waits on completion messages for predecessors in other parts, edges inside a part are resolved locally
+template <typename TTransport = TPipeTransport>
+struct TProcessRunner {
+
+    // 'execute' is called with each node id inside the child process that owns it
+    // Returns false if any part failed, the remaining parts are then killed
+    template <typename TExecute>
+    bool operator()(const TCompiledGraph& graph, const TGraphPartition& partition, TExecute&& execute) const {
+        const size_t partCount = partition.costs.size();
+
+        TTransport transport;
+        transport.open(partCount);
+
+        // Anything still buffered would otherwise be written once per child
+        std::cout.flush();
+        std::fflush(nullptr);
+
+        std::vector<pid_t> children;
+        for (size_t part = 0; part < partCount; ++part) {
+            const pid_t child = ::fork();
+            if (child < 0) {
+                for (pid_t other : children)
+                    ::kill(other, SIGKILL);
+                for (pid_t other : children)
+                    ::waitpid(other, nullptr, 0);
+                throw std::runtime_error(std::string("Could not fork: ") + std::strerror(errno));
+            }
+
+            if (child == 0) {
+                int status = 0;
+                try {
+                    transport.bind(part);
+                    runPart(graph, partition, part, transport, execute);
+                } catch (...) {
+                    status = 1;
+                }
+                std::cout.flush();
+                std::fflush(nullptr);
+                ::_exit(status);
+            }
+
+            children.push_back(child);
+        }
+
+        transport.close();
+
+        // Any child may fail first and the others could be waiting on it, so poll all of them
+        // Only our own children are waited on, the exit status of anything else the host forked is left to the host
+        bool succeeded = true;
+        std::vector<pid_t> running = children;
+        while (!running.empty()) {
+            bool exited = false;
+            for (size_t index = 0; index < running.size();) {
+                int status = 0;
+                const pid_t child = ::waitpid(running[index], &status, WNOHANG);
+                if (child == 0 || (child < 0 && errno == EINTR)) {
+                    ++index;
+                    continue;
+                }
+
+                // A child that cannot be waited on any more is gone without a status we could check
+                const bool failed = child < 0 || !(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+                if (succeeded && failed) {
+                    succeeded = false;
+                    for (pid_t other : running)
+                        if (other != running[index])
+                            ::kill(other, SIGKILL);
+                }
+                running[index] = running.back();
+                running.pop_back();
+                exited = true;
+            }
+
+            if (!exited && !running.empty())
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return succeeded;
+    }
+
+private:
+
+    template <typename TExecute>
+    static void runPart(const TCompiledGraph& graph, const TGraphPartition& partition, const size_t part, TTransport& transport, TExecute& execute) {
+        std::vector<size_t> inDegree = graph.inDegree;
+        std::vector<size_t> ready;
+        size_t total = 0;
+        for (size_t node = 0; node < graph.size(); ++node) {
+            if (partition.parts[node] != part || graph.isRemoved(node))
+                continue;
+            ++total;
+            if (inDegree[node] == 0)
+                ready.push_back(node);
+        }
+
+        std::vector<size_t> received;
+        std::vector<bool> notified(partition.costs.size(), false);
+
+        const auto complete = [&](const size_t node) {
+            for (size_t dependency : graph.successors(node))
+                if (partition.parts[dependency] == part && --inDegree[dependency] == 0)
+                    ready.push_back(dependency);
+        };
+
+        for (size_t done = 0; done < total; ) {
+            if (ready.empty())
+                transport.receive(received);
+
+            for (size_t i = 0; i < received.size(); ++i)
+                complete(received[i]);
+            received.clear();
+
+            if (ready.empty())
+                continue;
+
+            const size_t node = ready.back();
+            ready.pop_back();
+            execute(node);
+            ++done;
+            complete(node);
+
+            // A part only needs to hear about a node once, no matter how many of its nodes wait on it
+            std::fill(notified.begin(), notified.end(), false);
+            for (size_t dependency : graph.successors(node)) {
+                const size_t other = partition.parts[dependency];
+                if (other == part || notified[other])
+                    continue;
+                notified[other] = true;
+                transport.send(other, node, received);
+            }
+        }
+    }
+};
+
+#endif
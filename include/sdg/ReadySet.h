@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+
+#include "DependencyGraph.h"
+
+// Hands out nodes as soon as everything they depend on completed, instead of sorting the whole graph up front
+// Lets a caller start executing the first nodes right away, or an external scheduler drive the graph node by node
+// The graph has to outlive the ready set
+template <typename TGraph = TCompiledGraph>
+struct TReadySet {
+
+    explicit TReadySet(const TGraph& graph): graph(graph), inDegree(graph.inDegree.begin(), graph.inDegree.end()), states(graph.size(), WAITING) {
+        remaining = graph.size() - graph.removedCount;
+        for (size_t node = 0; node < graph.size(); ++node) {
+            if (inDegree[node] == 0 && !graph.isRemoved(node)) {
+                states[node] = READY;
+                ready.push_back(node);
+            }
+        }
+    }
+
+    // Takes the next ready node, returns false if none is ready until a running node completes
+    bool next(size_t& node) {
+        if (head == ready.size()) {
+            if (running == 0 && remaining > 0)
+                throw std::runtime_error("Cycle detected in dependency graph!");
+            return false;
+        }
+
+        node = ready[head++];
+        states[node] = RUNNING;
+        ++running;
+
+        // The consumed front is dropped once it outweighs the rest, so the queue stays proportional to the ready nodes
+        if (head > 64 && head * 2 > ready.size()) {
+            ready.erase(ready.begin(), ready.begin() + static_cast<std::ptrdiff_t>(head));
+            head = 0;
+        }
+        return true;
+    }
+
+    // Unlocks the nodes that were only waiting on 'node'
+    void markComplete(const size_t node) {
+        if (states[node] != RUNNING)
+            throw std::invalid_argument("Only nodes handed out by next() can be completed!");
+
+        states[node] = COMPLETE;
+        --running;
+        --remaining;
+        for (size_t dependency : graph.successors(node)) {
+            if (--inDegree[dependency] == 0) {
+                states[dependency] = READY;
+                ready.push_back(dependency);
+            }
+        }
+    }
+
+    bool finished() const { return remaining == 0; }
+
+    // Handed out by next() but not completed yet
+    size_t runningCount() const { return running; }
+    size_t readyCount() const { return ready.size() - head; }
+
+private:
+
+    enum : uint8_t { WAITING, READY, RUNNING, COMPLETE };
+
+    const TGraph& graph;
+    std::vector<size_t> inDegree;
+    std::vector<uint8_t> states;
+    std::vector<size_t> ready;
+    size_t head = 0;
+    size_t running = 0;
+    size_t remaining = 0;
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+
+#include "DependencyGraph.h"
+
+// Keeps the physical objects behind transient resources alive across frames, matched by descriptor (size, format, usage, ...)
+// Resources whose lifetimes do not overlap in the order share an object, and objects unused for 'maxUnusedFrames' are freed,
+// so once the frames settle, binding allocates and frees nothing
+// 'TDescriptor' needs == and a getHash overload, 'TPhysical' is a cheap handle to the object, e.g. an id or a pointer
+template <typename TDescriptor, typename TPhysical>
+struct TResourcePool {
+
+    struct Stats {
+        size_t allocations = 0;
+        size_t reuses = 0;
+        size_t evictions = 0;
+    };
+
+    explicit TResourcePool(const size_t maxUnusedFrames = 3): maxUnusedFrames(std::max<size_t>(maxUnusedFrames, 1)) {}
+
+    // Starts a frame and returns the physical object of every transient resource in 'order'
+    // 'describe(resource)' gives the descriptor of a resource, 'allocate(descriptor)' creates an object and 'release(physical)' frees one
+    template <typename TType, typename TDependencyType, typename TTopologicalSorter, typename TDescribe, typename TAllocate, typename TRelease>
+    std::unordered_map<TDependencyType, TPhysical, typename TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>::Hasher> bind(const TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>& graph, const std::vector<size_t>& order, TDescribe&& describe, TAllocate&& allocate, TRelease&& release) {
+        ++frame;
+
+        // Lifetimes come in the order resources are first used, so an object is free for a resource once its last user ran before it
+        std::unordered_map<TDependencyType, TPhysical, typename TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>::Hasher> bindings;
+        for (const auto& lifetime : graph.computeLifetimes(order)) {
+            if (lifetime.persistent)
+                continue;
+
+            auto& entries = pool[describe(lifetime.resource)];
+            Entry* free = nullptr;
+            for (Entry& entry : entries) {
+                if (entry.lastFrame != frame || entry.busyUntil < lifetime.first) {
+                    free = &entry;
+                    break;
+                }
+            }
+
+            if (free) {
+                ++stats.reuses;
+            } else {
+                entries.push_back(Entry{allocate(describe(lifetime.resource))});
+                free = &entries.back();
+                ++stats.allocations;
+            }
+            free->lastFrame = frame;
+            free->busyUntil = lifetime.last;
+            bindings.emplace(lifetime.resource, free->physical);
+        }
+
+        evict(std::forward<TRelease>(release));
+        return bindings;
+    }
+
+    // Frees every object, e.g. on shutdown or when the device is lost
+    template <typename TRelease>
+    void clear(TRelease&& release) {
+        for (auto& [descriptor, entries] : pool)
+            for (Entry& entry : entries)
+                release(entry.physical);
+        stats.evictions += size();
+        pool.clear();
+    }
+
+    // Objects currently kept by the pool
+    size_t size() const {
+        size_t count = 0;
+        for (const auto& [descriptor, entries] : pool)
+            count += entries.size();
+        return count;
+    }
+
+    Stats stats;
+
+private:
+
+    struct Entry {
+        TPhysical physical;
+        uint64_t lastFrame = 0;
+        // Rank of the last pass in this frame's order that uses the object
+        size_t busyUntil = 0;
+    };
+
+    struct DescriptorHasher {
+        size_t operator()(const TDescriptor& descriptor) const noexcept {
+            return getHash(descriptor);
+        }
+    };
+
+    template <typename TRelease>
+    void evict(TRelease&& release) {
+        for (auto bucket = pool.begin(); bucket != pool.end();) {
+            auto& entries = bucket->second;
+            for (size_t index = 0; index < entries.size();) {
+                if (frame - entries[index].lastFrame >= maxUnusedFrames) {
+                    release(entries[index].physical);
+                    entries[index] = std::move(entries.back());
+                    entries.pop_back();
+                    ++stats.evictions;
+                } else {
+                    ++index;
+                }
+            }
+            bucket = entries.empty() ? pool.erase(bucket) : std::next(bucket);
+        }
+    }
+
+    std::unordered_map<TDescriptor, std::vector<Entry>, DescriptorHasher> pool;
+    size_t maxUnusedFrames;
+    uint64_t frame = 0;
+};
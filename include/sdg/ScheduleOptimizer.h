@@ -0,0 +1,247 @@
+#pragma once
+
+#include <cmath>
+#include <istream>
+#include <ostream>
+#include <random>
+#include <string>
+
+#include "Scheduling.h"
+
+struct TScheduleObjective {
+    double memoryWeight = 1.0;
+    double barrierWeight = 1.0;
+    double makespanWeight = 1.0;
+};
+
+struct TScheduleCost {
+    // Summed size of the resources alive during the busiest pass
+    double peakMemory = 0.0;
+    // Points in the order where a pass waits on a pass after the previous barrier
+    size_t barriers = 0;
+    // Finish time of the last pass, issuing passes in order onto the lanes
+    double makespan = 0.0;
+    double total = 0.0;
+};
+
+struct TOptimizedSchedule {
+    std::vector<size_t> order;
+    TScheduleCost cost;
+
+    // False if the graph changed in a way the order no longer respects
+    bool isValid(const TCompiledGraph& graph) const {
+        if (order.size() + graph.removedCount != graph.size())
+            return false;
+
+        std::vector<size_t> ranks(graph.size(), SIZE_MAX);
+        for (size_t rank = 0; rank < order.size(); ++rank) {
+            if (order[rank] >= graph.size() || graph.isRemoved(order[rank]) || ranks[order[rank]] != SIZE_MAX)
+                return false;
+            ranks[order[rank]] = rank;
+        }
+        for (size_t node = 0; node < graph.size(); ++node)
+            for (size_t dependency : graph.successors(node))
+                if (ranks[node] > ranks[dependency])
+                    return false;
+        return true;
+    }
+
+    void serialize(std::ostream& stream) const {
+        stream << "SimpleDGSchedule 1\n" << order.size() << '\n';
+        for (size_t node : order)
+            stream << node << ' ';
+        stream << '\n' << cost.peakMemory << ' ' << cost.barriers << ' ' << cost.makespan << ' ' << cost.total << '\n';
+    }
+
+    static TOptimizedSchedule deserialize(std::istream& stream) {
+        std::string magic;
+        int version = 0;
+        size_t count = 0;
+        if (!(stream >> magic >> version >> count) || magic != "SimpleDGSchedule" || version != 1)
+            throw std::runtime_error("Not a serialized schedule!");
+
+        TOptimizedSchedule schedule;
+        schedule.order.resize(count);
+        for (size_t& node : schedule.order)
+            stream >> node;
+        stream >> schedule.cost.peakMemory >> schedule.cost.barriers >> schedule.cost.makespan >> schedule.cost.total;
+        if (!stream)
+            throw std::runtime_error("Truncated serialized schedule!");
+        return schedule;
+    }
+};
+
+// Offline search for a better order of a graph that is compiled once and executed many times
+// Starts from the Kahn order and anneals over legal moves, i.e. swapping independent neighbours
+// and moving a pass anywhere between its last predecessor and first successor, every order it visits is valid
+struct TScheduleOptimizer {
+
+    TScheduleObjective objective;
+    size_t iterations = 20000;
+    // Lanes the makespan estimate issues passes onto
+    size_t lanes = 2;
+    uint64_t seed = 1;
+
+    // 'nodeCost' gives the estimated time of a pass and 'resourceSize' the memory of a resource
+    template <typename TType, typename TDependencyType, typename TTopologicalSorter, typename TNodeCost, typename TResourceSize>
+    TOptimizedSchedule operator()(const TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>& graph, TNodeCost&& nodeCost, TResourceSize&& resourceSize) const {
+        std::vector<TDependencyType> resources;
+
+        Problem problem;
+        problem.graph = graph.compile();
+        problem.usage = TResourceUsage::build(graph, resources);
+        problem.costs.resize(graph.size());
+        for (size_t node = 0; node < graph.size(); ++node)
+            problem.costs[node] = nodeCost(node);
+        problem.sizes.reserve(resources.size());
+        for (const auto& resource : resources)
+            problem.sizes.push_back(resourceSize(resource));
+
+        return optimize(problem);
+    }
+
+    // Every pass takes 1 and every resource has size 1
+    template <typename TType, typename TDependencyType, typename TTopologicalSorter>
+    TOptimizedSchedule operator()(const TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>& graph) const {
+        return (*this)(graph, [](size_t) { return 1.0; }, [](const TDependencyType&) { return 1.0; });
+    }
+
+private:
+
+    struct Problem {
+        TCompiledGraph graph;
+        TResourceUsage usage;
+        std::vector<double> costs;
+        std::vector<double> sizes;
+    };
+
+    TScheduleCost evaluate(const Problem& problem, const std::vector<size_t>& order, std::vector<size_t>& ranks) const {
+        const size_t resourceCount = problem.usage.resourceCount;
+        for (size_t rank = 0; rank < order.size(); ++rank)
+            ranks[order[rank]] = rank;
+
+        TScheduleCost cost;
+
+        // Peak memory, sweeping over the lifetime of each resource
+        std::vector<size_t> first(resourceCount, SIZE_MAX), last(resourceCount, 0);
+        for (size_t rank = 0; rank < order.size(); ++rank) {
+            for (size_t resource : problem.usage.resourcesOf(order[rank])) {
+                first[resource] = std::min(first[resource], rank);
+                last[resource] = rank;
+            }
+        }
+        std::vector<double> delta(order.size() + 1, 0.0);
+        for (size_t resource = 0; resource < resourceCount; ++resource) {
+            if (first[resource] == SIZE_MAX)
+                continue;
+            delta[first[resource]] += problem.sizes[resource];
+            delta[last[resource] + 1] -= problem.sizes[resource];
+        }
+        double live = 0.0;
+        for (size_t rank = 0; rank < order.size(); ++rank) {
+            live += delta[rank];
+            cost.peakMemory = std::max(cost.peakMemory, live);
+        }
+
+        // Barriers, a pass that depends on anything since the last barrier needs a new one, so independent passes batch up
+        size_t lastBarrier = 0;
+        for (size_t rank = 0; rank < order.size(); ++rank) {
+            for (size_t base : problem.graph.predecessors(order[rank])) {
+                if (ranks[base] >= lastBarrier) {
+                    lastBarrier = rank;
+                    ++cost.barriers;
+                    break;
+                }
+            }
+        }
+
+        // Makespan, each pass is issued in order on the lane that frees up first once its inputs are done
+        std::vector<double> laneFree(std::max<size_t>(lanes, 1), 0.0);
+        std::vector<double> finish(problem.graph.size(), 0.0);
+        double issued = 0.0;
+        for (size_t node : order) {
+            const auto lane = std::min_element(laneFree.begin(), laneFree.end());
+            double start = std::max(*lane, issued);
+            for (size_t base : problem.graph.predecessors(node))
+                start = std::max(start, finish[base]);
+            finish[node] = start + problem.costs[node];
+            *lane = finish[node];
+            issued = start;
+            cost.makespan = std::max(cost.makespan, finish[node]);
+        }
+
+        cost.total = objective.memoryWeight * cost.peakMemory + objective.barrierWeight * static_cast<double>(cost.barriers) + objective.makespanWeight * cost.makespan;
+        return cost;
+    }
+
+    TOptimizedSchedule optimize(const Problem& problem) const {
+        const TCompiledGraph& graph = problem.graph;
+        std::vector<size_t> ranks(graph.size(), SIZE_MAX);
+
+        TOptimizedSchedule current;
+        current.order = TKahnTopologicalSort{}(graph);
+        current.cost = evaluate(problem, current.order, ranks);
+        TOptimizedSchedule best = current;
+
+        if (current.order.size() < 2)
+            return best;
+
+        const auto dependsOn = [&](const size_t node, const size_t base) {
+            const auto successors = graph.successors(base);
+            return std::binary_search(successors.begin(), successors.end(), node);
+        };
+
+        std::mt19937_64 random(seed);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+        // Starts out accepting moves that cost a few percent more, and cools down to pure descent
+        const double startTemperature = std::max(current.cost.total * 0.05, 1e-9);
+        std::vector<size_t> candidate;
+
+        for (size_t iteration = 0; iteration < iterations; ++iteration) {
+            const double temperature = startTemperature * std::pow(1e-4, static_cast<double>(iteration) / static_cast<double>(iterations));
+            candidate = current.order;
+
+            for (size_t rank = 0; rank < candidate.size(); ++rank)
+                ranks[candidate[rank]] = rank;
+
+            const size_t from = random() % candidate.size();
+            const size_t node = candidate[from];
+
+            if (random() % 2 == 0) {
+                // Swap with the next pass when neither depends on the other
+                if (from + 1 >= candidate.size() || dependsOn(candidate[from + 1], node))
+                    continue;
+                std::swap(candidate[from], candidate[from + 1]);
+            } else {
+                // Move anywhere after the last predecessor and before the first successor
+                size_t low = 0, high = candidate.size() - 1;
+                for (size_t base : graph.predecessors(node))
+                    low = std::max(low, ranks[base] + 1);
+                for (size_t dependency : graph.successors(node))
+                    high = std::min(high, ranks[dependency] - 1);
+                if (high <= low)
+                    continue;
+
+                const size_t to = low + random() % (high - low + 1);
+                if (to == from)
+                    continue;
+                if (to < from)
+                    std::rotate(candidate.begin() + static_cast<std::ptrdiff_t>(to), candidate.begin() + static_cast<std::ptrdiff_t>(from), candidate.begin() + static_cast<std::ptrdiff_t>(from + 1));
+                else
+                    std::rotate(candidate.begin() + static_cast<std::ptrdiff_t>(from), candidate.begin() + static_cast<std::ptrdiff_t>(from + 1), candidate.begin() + static_cast<std::ptrdiff_t>(to + 1));
+            }
+
+            const TScheduleCost cost = evaluate(problem, candidate, ranks);
+            const double change = cost.total - current.cost.total;
+            if (change <= 0.0 || unit(random) < std::exp(-change / temperature)) {
+                current.order.swap(candidate);
+                current.cost = cost;
+                if (current.cost.total < best.cost.total)
+                    best = current;
+            }
+        }
+
+        return best;
+    }
+};
@@ -0,0 +1,222 @@
+#pragma once
+
+#include "DependencyGraph.h"
+
+// Schedules every node as late as possible, by running Kahn on the reversed graph and reversing the result
+// Producers move right before their first consumer, which shortens the lifetime of what they produce
+struct TALAPTopologicalSort {
+
+    std::vector<size_t> operator()(const TCompiledGraph& graph) const {
+        // A node that nothing waits on starts at 0
+        std::vector<size_t> outDegree(graph.size());
+        for (size_t node = 0; node < graph.size(); ++node)
+            outDegree[node] = graph.successors(node).size();
+
+        std::vector<size_t> order;
+        order.reserve(graph.size());
+        for (size_t id = 0; id < graph.size(); ++id)
+            if (outDegree[id] == 0 && !graph.isRemoved(id))
+                order.push_back(id);
+
+        for (size_t head = 0; head < order.size(); ++head) {
+            for (size_t base : graph.predecessors(order[head])) {
+                if (--outDegree[base] == 0) {
+                    order.push_back(base);
+                }
+            }
+        }
+
+        if (order.size() + graph.removedCount != graph.size())
+            throw std::runtime_error("Cycle detected in dependency graph!");
+
+        std::reverse(order.begin(), order.end());
+        return order;
+    }
+};
+
+struct TScheduleComparison {
+    std::vector<size_t> asapOrder;
+    std::vector<size_t> alapOrder;
+    size_t asapPeakLiveResources = 0;
+    size_t alapPeakLiveResources = 0;
+
+    // The order with fewer resources alive at once, ASAP on a tie
+    const std::vector<size_t>& best() const {
+        return alapPeakLiveResources < asapPeakLiveResources ? alapOrder : asapOrder;
+    }
+};
+
+// Sorts a read/write graph both as soon and as late as possible and measures the peak live resources of each
+template <typename TType, typename TDependencyType, typename TTopologicalSorter>
+TScheduleComparison compareSchedules(const TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>& graph) {
+    const TCompiledGraph compiled = graph.compile();
+
+    TScheduleComparison comparison;
+    comparison.asapOrder = TKahnTopologicalSort{}(compiled);
+    comparison.alapOrder = TALAPTopologicalSort{}(compiled);
+    comparison.asapPeakLiveResources = graph.peakLiveResources(comparison.asapOrder);
+    comparison.alapPeakLiveResources = graph.peakLiveResources(comparison.alapOrder);
+    return comparison;
+}
+
+// Dense per pass resource lists of a read/write graph, resources are numbered in the order they are first used
+struct TResourceUsage {
+
+    template <typename TType, typename TDependencyType, typename TTopologicalSorter>
+    static TResourceUsage build(const TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>& graph) {
+        std::vector<TDependencyType> values;
+        return build(graph, values);
+    }
+
+    // Also fills 'values' with the resource behind each index
+    template <typename TType, typename TDependencyType, typename TTopologicalSorter>
+    static TResourceUsage build(const TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>& graph, std::vector<TDependencyType>& values) {
+        using TGraph = TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>;
+        values.clear();
+
+        TResourceUsage usage;
+        usage.offsets.reserve(graph.size() + 1);
+        usage.offsets.push_back(0);
+
+        std::unordered_map<TDependencyType, size_t, typename TGraph::Hasher> indices;
+        std::vector<size_t> lastSeen;
+        for (size_t node = 0; node < graph.size(); ++node) {
+            const auto accesses = graph.dependencies.find(node);
+            if (accesses != graph.dependencies.end()) {
+                // Walked backwards, so a pass that reads and writes a resource only lists it once, at its last access
+                for (auto access = accesses->second.rbegin(); access != accesses->second.rend(); ++access) {
+                    const auto [it, inserted] = indices.try_emplace(access->node, indices.size());
+                    if (inserted)
+                        values.push_back(access->node);
+                    const size_t resource = it->second;
+                    lastSeen.resize(indices.size(), SIZE_MAX);
+                    if (lastSeen[resource] == node)
+                        continue;
+                    lastSeen[resource] = node;
+                    usage.recent.push_back(resource);
+                }
+            }
+            usage.offsets.push_back(usage.recent.size());
+        }
+
+        usage.resources = usage.recent;
+        for (size_t node = 0; node < graph.size(); ++node)
+            std::sort(usage.resources.begin() + static_cast<std::ptrdiff_t>(usage.offsets[node]), usage.resources.begin() + static_cast<std::ptrdiff_t>(usage.offsets[node + 1]));
+
+        usage.resourceCount = indices.size();
+        return usage;
+    }
+
+    // Sorted by resource index
+    TCompiledGraph::Range resourcesOf(const size_t node) const {
+        return TCompiledGraph::Range{resources.data() + offsets[node], resources.data() + offsets[node + 1]};
+    }
+
+    // The same resources, the one the pass touched last first
+    TCompiledGraph::Range recentResourcesOf(const size_t node) const {
+        return TCompiledGraph::Range{recent.data() + offsets[node], recent.data() + offsets[node + 1]};
+    }
+
+    bool shareResource(const size_t a, const size_t b) const {
+        const auto first = resourcesOf(a), second = resourcesOf(b);
+        const size_t* i = first.begin();
+        const size_t* j = second.begin();
+        while (i != first.end() && j != second.end()) {
+            if (*i == *j)
+                return true;
+            if (*i < *j)
+                ++i;
+            else
+                ++j;
+        }
+        return false;
+    }
+
+    // How often consecutive passes of the order share no resource, i.e. the working set had to change
+    size_t countResourceSwitches(const std::vector<size_t>& order) const {
+        size_t switches = 0;
+        for (size_t rank = 1; rank < order.size(); ++rank)
+            if (!shareResource(order[rank - 1], order[rank]))
+                ++switches;
+        return switches;
+    }
+
+    std::vector<size_t> offsets;
+    std::vector<size_t> resources;
+    std::vector<size_t> recent;
+    size_t resourceCount = 0;
+};
+
+struct TAffinityOrder {
+    std::vector<size_t> order;
+    size_t resourceSwitches = 0;
+};
+
+// Among the ready passes, prefers one that uses the resources the previous pass touched last, so working sets
+// stay in cache and resources stay in the same state for longer runs, falls back to Kahn order otherwise
+struct TResourceAffinitySort {
+
+    template <typename TType, typename TDependencyType, typename TTopologicalSorter>
+    TAffinityOrder operator()(const TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>& graph) const {
+        const TCompiledGraph compiled = graph.compile();
+        const TResourceUsage usage = TResourceUsage::build(graph);
+
+        std::vector<size_t> inDegree = compiled.inDegree;
+        std::vector<bool> scheduled(compiled.size(), false);
+
+        // Ready passes are queued once overall and once per resource they use, stale entries are skipped lazily
+        std::vector<size_t> ready;
+        size_t head = 0;
+        std::vector<std::vector<size_t>> readyByResource(usage.resourceCount);
+
+        const auto makeReady = [&](const size_t node) {
+            ready.push_back(node);
+            for (size_t resource : usage.resourcesOf(node))
+                readyByResource[resource].push_back(node);
+        };
+
+        for (size_t node = 0; node < compiled.size(); ++node)
+            if (inDegree[node] == 0 && !compiled.isRemoved(node))
+                makeReady(node);
+
+        TAffinityOrder result;
+        result.order.reserve(compiled.size());
+
+        while (true) {
+            size_t next = SIZE_MAX;
+
+            if (!result.order.empty()) {
+                for (size_t resource : usage.recentResourcesOf(result.order.back())) {
+                    auto& candidates = readyByResource[resource];
+                    while (!candidates.empty() && scheduled[candidates.back()])
+                        candidates.pop_back();
+                    if (!candidates.empty()) {
+                        next = candidates.back();
+                        candidates.pop_back();
+                        break;
+                    }
+                }
+            }
+
+            if (next == SIZE_MAX) {
+                while (head < ready.size() && scheduled[ready[head]])
+                    ++head;
+                if (head == ready.size())
+                    break;
+                next = ready[head++];
+            }
+
+            scheduled[next] = true;
+            result.order.push_back(next);
+            for (size_t dependency : compiled.successors(next))
+                if (--inDegree[dependency] == 0)
+                    makeReady(dependency);
+        }
+
+        if (result.order.size() + compiled.removedCount != compiled.size())
+            throw std::runtime_error("Cycle detected in dependency graph!");
+
+        result.resourceSwitches = usage.countResourceSwitches(result.order);
+        return result;
+    }
+};
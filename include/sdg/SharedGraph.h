@@ -0,0 +1,268 @@
+#pragma once
+
+#include "DependencyGraph.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A compiled graph that lives in a POSIX shared memory segment, so several processes can map it and run it together
+// Workers claim ready nodes from a queue in the segment and release their successors with atomic counters,
+// the graph itself is only stored once no matter how many processes use it
+struct TSharedGraph {
+
+    static_assert(std::atomic<size_t>::is_always_lock_free, "Shared graphs need address free atomics");
+
+    TSharedGraph() = default;
+    TSharedGraph(const TSharedGraph&) = delete;
+    TSharedGraph& operator=(const TSharedGraph&) = delete;
+    TSharedGraph(TSharedGraph&& other) noexcept { *this = std::move(other); }
+
+    TSharedGraph& operator=(TSharedGraph&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            std::swap(name, other.name);
+            std::swap(memory, other.memory);
+            std::swap(bytes, other.bytes);
+            std::swap(owner, other.owner);
+        }
+        return *this;
+    }
+
+    // The creator owns the segment name and unlinks it once destroyed, processes that already mapped it keep working
+    ~TSharedGraph() {
+        unmap();
+        if (owner)
+            ::shm_unlink(name.c_str());
+    }
+
+    // 'name' follows shm_open rules, i.e. "/name"
+    // Throws on a cycle, as run() would otherwise wait forever on a node that never becomes ready
+    static TSharedGraph create(const std::string& name, const TCompiledGraph& graph) {
+        TKahnTopologicalSort{}(graph);
+
+        size_t bytes = 0;
+        if (!segmentBytes(graph.size(), graph.edgeCount(), bytes))
+            throw std::invalid_argument("Shared graph '" + name + "' is too large!");
+
+        const int file = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (file < 0)
+            throw std::runtime_error("Could not create shared graph '" + name + "': " + std::strerror(errno));
+        if (::ftruncate(file, static_cast<off_t>(bytes)) != 0) {
+            const int error = errno;
+            ::close(file);
+            ::shm_unlink(name.c_str());
+            throw std::runtime_error("Could not size shared graph '" + name + "': " + std::strerror(error));
+        }
+
+        TSharedGraph result;
+        result.name = name;
+        result.owner = true;
+        result.map(file, bytes);
+
+        Header* header = new (result.memory) Header{};
+        header->nodeCount = graph.size();
+        header->edgeCount = graph.edgeCount();
+        header->liveCount = graph.size() - graph.removedCount;
+        std::copy(graph.offsets.begin(), graph.offsets.end(), result.offsets());
+        std::copy(graph.targets.begin(), graph.targets.end(), result.targets());
+        std::copy(graph.inDegree.begin(), graph.inDegree.end(), result.inDegree());
+        for (size_t node = 0; node < graph.size(); ++node) {
+            new (result.remaining() + node) std::atomic<size_t>(0);
+            new (result.queue() + node) std::atomic<size_t>(0);
+            result.removed()[node] = graph.isRemoved(node);
+        }
+        result.reset();
+
+        // Published last, so a process that opens the segment early never sees a half written graph
+        header->magic.store(Header::MAGIC, std::memory_order_release);
+        return result;
+    }
+
+    static TSharedGraph open(const std::string& name) {
+        const int file = ::shm_open(name.c_str(), O_RDWR, 0600);
+        if (file < 0)
+            throw std::runtime_error("Could not open shared graph '" + name + "': " + std::strerror(errno));
+
+        struct stat info{};
+        if (::fstat(file, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+            ::close(file);
+            throw std::runtime_error("Shared graph '" + name + "' is not initialized!");
+        }
+
+        TSharedGraph result;
+        result.name = name;
+        result.map(file, static_cast<size_t>(info.st_size));
+        const Header* header = result.header();
+        if (header->magic.load(std::memory_order_acquire) != Header::MAGIC)
+            throw std::runtime_error("Shared graph '" + name + "' is not initialized!");
+
+        // The counts locate every other array, so they are checked against the segment before anything else is read
+        size_t bytes = 0;
+        if (!segmentBytes(header->nodeCount, header->edgeCount, bytes) || bytes > result.bytes || header->liveCount > header->nodeCount)
+            throw std::runtime_error("Shared graph '" + name + "' does not fit its segment!");
+
+        const size_t* offsets = result.offsets();
+        if (offsets[0] != 0 || offsets[header->nodeCount] != header->edgeCount)
+            throw std::runtime_error("Shared graph '" + name + "' has corrupted edges!");
+        for (size_t node = 0; node < header->nodeCount; ++node)
+            if (offsets[node] > offsets[node + 1])
+                throw std::runtime_error("Shared graph '" + name + "' has corrupted edges!");
+        for (size_t edge = 0; edge < header->edgeCount; ++edge)
+            if (result.targets()[edge] >= header->nodeCount)
+                throw std::runtime_error("Shared graph '" + name + "' has corrupted edges!");
+        return result;
+    }
+
+    size_t size() const { return header()->nodeCount; }
+    size_t edgeCount() const { return header()->edgeCount; }
+
+    TCompiledGraph::Range successors(const size_t node) const {
+        return TCompiledGraph::Range{targets() + offsets()[node], targets() + offsets()[node + 1]};
+    }
+
+    // Prepares a new run, no worker may be running while this is called
+    void reset() {
+        Header* state = header();
+        state->head.store(0, std::memory_order_relaxed);
+        state->tail.store(0, std::memory_order_relaxed);
+        state->failed.store(0, std::memory_order_relaxed);
+        state->finished.store(0, std::memory_order_relaxed);
+        for (size_t node = 0; node < size(); ++node) {
+            remaining()[node].store(inDegree()[node], std::memory_order_relaxed);
+            queue()[node].store(0, std::memory_order_relaxed);
+        }
+        for (size_t node = 0; node < size(); ++node)
+            if (inDegree()[node] == 0 && !removed()[node])
+                push(node);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    // Executes nodes until the whole graph ran, can be called from any number of processes and threads at once
+    // Returns how many nodes this worker executed, if 'execute' throws every worker stops and the exception is rethrown
+    // A worker that dies mid-node never releases its successors, so a worker that waits while no node finishes for 'stallTimeout'
+    // stops every worker with an exception, nodes that run longer than that need a longer timeout
+    template <typename TExecute>
+    size_t run(TExecute&& execute, const std::chrono::milliseconds stallTimeout = std::chrono::seconds(30)) {
+        Header* state = header();
+        size_t executed = 0;
+
+        while (true) {
+            const size_t slot = state->head.fetch_add(1, std::memory_order_relaxed);
+            if (slot >= state->liveCount)
+                return executed;
+
+            // Every live node is pushed exactly once, so a claimed slot is always filled eventually
+            size_t value;
+            size_t finished = state->finished.load(std::memory_order_relaxed);
+            auto progress = std::chrono::steady_clock::now();
+            for (size_t spin = 1; (value = queue()[slot].load(std::memory_order_acquire)) == 0; ++spin) {
+                if (state->failed.load(std::memory_order_relaxed))
+                    throw std::runtime_error("Another worker of the shared graph failed!");
+
+                // The clock is only read now and then, short waits are the common case
+                if (spin % 1024 == 0) {
+                    const auto now = std::chrono::steady_clock::now();
+                    if (state->finished.load(std::memory_order_relaxed) != finished) {
+                        finished = state->finished.load(std::memory_order_relaxed);
+                        progress = now;
+                    } else if (now - progress > stallTimeout) {
+                        state->failed.store(1, std::memory_order_relaxed);
+                        throw std::runtime_error("No node of the shared graph finished in time, a worker may have died!");
+                    }
+                }
+                std::this_thread::yield();
+            }
+
+            const size_t node = value - 1;
+            try {
+                execute(node);
+            } catch (...) {
+                state->failed.store(1, std::memory_order_relaxed);
+                throw;
+            }
+            ++executed;
+
+            for (size_t dependency : successors(node))
+                if (remaining()[dependency].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    push(dependency);
+            state->finished.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+private:
+
+    struct Header {
+        static constexpr size_t MAGIC = 0x5344475348415245;
+
+        std::atomic<size_t> magic{0};
+        size_t nodeCount = 0;
+        size_t edgeCount = 0;
+        // Removed nodes are never queued
+        size_t liveCount = 0;
+        // Next queue slot to claim and next queue slot to fill
+        std::atomic<size_t> head{0};
+        std::atomic<size_t> tail{0};
+        std::atomic<size_t> failed{0};
+        // Nodes that ran so far, waiting workers watch it to tell a slow graph from a dead worker
+        std::atomic<size_t> finished{0};
+    };
+
+    // Bytes of the segment for a graph of that size, false if it could never be addressed
+    static bool segmentBytes(const size_t nodeCount, const size_t edgeCount, size_t& bytes) {
+        const size_t limit = SIZE_MAX / 64;
+        if (nodeCount > limit || edgeCount > limit)
+            return false;
+        bytes = sizeof(Header) + sizeof(size_t) * (nodeCount + 1 + edgeCount + nodeCount) + sizeof(std::atomic<size_t>) * nodeCount * 2 + nodeCount;
+        return true;
+    }
+
+    void map(const int file, const size_t size) {
+        void* mapped = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        const int error = errno;
+        ::close(file);
+        if (mapped == MAP_FAILED)
+            throw std::runtime_error("Could not map shared graph '" + name + "': " + std::strerror(error));
+        memory = static_cast<unsigned char*>(mapped);
+        bytes = size;
+    }
+
+    void unmap() {
+        if (memory)
+            ::munmap(memory, bytes);
+        memory = nullptr;
+        bytes = 0;
+    }
+
+    void push(const size_t node) {
+        const size_t slot = header()->tail.fetch_add(1, std::memory_order_relaxed);
+        queue()[slot].store(node + 1, std::memory_order_release);
+    }
+
+    // Segment layout: header, offsets, targets, in degree snapshot, remaining in degree, ready queue, removed flags
+    Header* header() const { return reinterpret_cast<Header*>(memory); }
+    size_t* offsets() const { return reinterpret_cast<size_t*>(memory + sizeof(Header)); }
+    size_t* targets() const { return offsets() + header()->nodeCount + 1; }
+    size_t* inDegree() const { return targets() + header()->edgeCount; }
+    std::atomic<size_t>* remaining() const { return reinterpret_cast<std::atomic<size_t>*>(inDegree() + header()->nodeCount); }
+    std::atomic<size_t>* queue() const { return remaining() + header()->nodeCount; }
+    unsigned char* removed() const { return reinterpret_cast<unsigned char*>(queue() + header()->nodeCount); }
+
+    std::string name;
+    unsigned char* memory = nullptr;
+    size_t bytes = 0;
+    bool owner = false;
+};
+
+#endif
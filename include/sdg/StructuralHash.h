@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+
+#include "DependencyGraph.h"
+
+// Merkle style hashes, each node hashes its own identity together with the hashes of everything it depends on
+// Two nodes only share a hash if they and their whole upstream are the same, no matter which ids they have,
+// so caches keyed on it stay valid for every part of a graph that a change did not reach
+struct TStructuralHashes {
+
+    static uint64_t mix(uint64_t value) {
+        value += 0x9E3779B97F4A7C15ull;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        return value ^ (value >> 31);
+    }
+
+    static uint64_t combine(const uint64_t seed, const uint64_t value) {
+        return mix(seed ^ (value + 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2)));
+    }
+
+    // 'identities' is the hash of each node on its own, removed nodes get 0
+    static TStructuralHashes compute(const TCompiledGraph& graph, const std::vector<uint64_t>& identities) {
+        TStructuralHashes hashes;
+        hashes.nodes.assign(graph.size(), 0);
+        hashes.identities = identities;
+
+        // Predecessors are sorted by hash rather than id, so renumbering a graph keeps every hash
+        std::vector<uint64_t> inputs;
+        for (size_t node : TKahnTopologicalSort{}(graph)) {
+            inputs.clear();
+            for (size_t base : graph.predecessors(node))
+                inputs.push_back(hashes.nodes[base]);
+            std::sort(inputs.begin(), inputs.end());
+
+            uint64_t hash = mix(identities[node]);
+            for (uint64_t input : inputs)
+                hash = combine(hash, input);
+            hashes.nodes[node] = hash;
+        }
+
+        std::vector<uint64_t> sorted = hashes.nodes;
+        std::sort(sorted.begin(), sorted.end());
+        hashes.graph = mix(graph.size());
+        for (uint64_t hash : sorted)
+            hashes.graph = combine(hashes.graph, hash);
+
+        return hashes;
+    }
+
+    // The identity of a pass is 'nodeHash' of its payload together with every access it declared, in order
+    template <typename TType, typename TDependencyType, typename TTopologicalSorter, typename TNodeHash>
+    static TStructuralHashes compute(const TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>& graph, TNodeHash&& nodeHash) {
+        using TGraph = TRWDependencyGraph<TType, TDependencyType, TTopologicalSorter>;
+
+        const typename TGraph::Hasher hasher;
+        std::vector<uint64_t> identities(graph.size(), 0);
+        for (size_t node = 0; node < graph.size(); ++node) {
+            if (graph.isRemoved(node))
+                continue;
+
+            uint64_t identity = mix(static_cast<uint64_t>(nodeHash(graph.getNode(node))));
+            const auto accesses = graph.dependencies.find(node);
+            if (accesses != graph.dependencies.end())
+                for (const auto& access : accesses->second)
+                    identity = combine(identity, combine(static_cast<uint64_t>(hasher(access.node)), access.type == TGraph::Access::WRITE));
+            identities[node] = identity;
+        }
+
+        return compute(graph.compile(), identities);
+    }
+
+    // Hash of each node by id
+    std::vector<uint64_t> nodes;
+    // Hash of each node on its own, without its upstream
+    std::vector<uint64_t> identities;
+    // Hash of the whole graph, independent of node ids
+    uint64_t graph = 0;
+};
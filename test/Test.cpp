@@ -3,8 +3,31 @@
 #include <string>
 #include <chrono>
 #include <functional>
+#include <memory>
+#include <thread>
+#include <sstream>
 
 #include "sdg/DependencyGraph.h"
+#include "sdg/GraphTemplate.h"
+#include "sdg/NestedGraph.h"
+#include "sdg/GraphRecorder.h"
+#include "sdg/CompressedGraph.h"
+#include "sdg/ReadySet.h"
+#include "sdg/Scheduling.h"
+#include "sdg/ScheduleOptimizer.h"
+#include "sdg/StructuralHash.h"
+#include "sdg/GraphDiff.h"
+#include "sdg/GraphLints.h"
+#include "sdg/ResourcePool.h"
+#include "sdg/PassMerging.h"
+#include "sdg/AsyncOverlap.h"
+#include "sdg/ProcessRunner.h"
+#include "sdg/SharedGraph.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/wait.h>
+#endif
 
 using namespace std::chrono;
 
@@ -31,6 +54,28 @@ struct SResource {
     }
 };
 
+struct STextureDescriptor {
+    size_t width = 0;
+    size_t height = 0;
+
+    bool operator==(const STextureDescriptor& other) const {
+        return width == other.width && height == other.height;
+    }
+
+    friend size_t getHash(const STextureDescriptor& descriptor) {
+        return descriptor.width * 31 + descriptor.height;
+    }
+};
+
+// A sorter written against the adjacency map, it only sees the graph that way
+struct SAdjacencySort {
+
+    template <typename TType>
+    std::vector<size_t> operator()(const std::vector<TType>& nodes, const std::unordered_map<size_t, std::vector<size_t>>& dependencies) const {
+        return TKahnTopologicalSort{}(nodes, dependencies);
+    }
+};
+
 int main() {
 
     {
@@ -77,11 +122,33 @@ int main() {
         graph.addRead(historyResolvePass, hdrColor);
         graph.addWrite(historyResolvePass, history);
 
+        // History is written this frame and read the next, TAA reads last frame's copy while the resolve writes the other one
+        graph.setResourceKind(history, decltype(graph)::TEMPORAL);
+
         const auto order = graph.buildExecutionOrder();
 
         for (const auto& node : order) {
             std::cout << graph.getNode(node)->name << " -> ";
         }
+        std::cout << std::endl;
+
+        // The next frame, TAA has to wait for the previous frame's history and the resolve for the previous frame's TAA
+        graph.buildExecutionOrder();
+        const char* hazardNames[] = {"RAW", "WAR", "WAW"};
+        for (const auto& hazard : graph.getCarriedHazards()) {
+            std::cout << graph.getNode(hazard.to)->name << " waits on the previous frame (" << hazardNames[hazard.type] << "), ";
+        }
+        std::cout << std::endl;
+
+        // Everything up to the upscale runs at render resolution and can stay in one render pass
+        const auto groups = findMergeablePasses(graph, order, [&](size_t, size_t pass) { return pass != upscalePass; });
+        for (const auto& group : groups) {
+            std::cout << "[ ";
+            for (size_t pass : group.passes) {
+                std::cout << graph.getNode(pass)->name << " ";
+            }
+            std::cout << "] " << group.attachments.size() << " attachments, " << group.internalAttachments.size() << " internal, ";
+        }
         std::cout << std::endl << std::endl;
 
         /*
@@ -96,5 +163,853 @@ int main() {
          */
     }
 
+    {
+        // Even with nothing else ordering them, TAA stays ahead of the resolve, so renumbering cannot make it read this frame's history
+        TRWDependencyGraph<std::shared_ptr<SObject>, SResource, TKahnTopologicalSort> graph;
+        const SResource history{2};
+        graph.setResourceKind(history, decltype(graph)::TEMPORAL);
+
+        size_t taaPass = graph.addNode(std::make_shared<SObject>("taaPass"));
+        graph.addRead(taaPass, history);
+
+        size_t historyResolvePass = graph.addNode(std::make_shared<SObject>("historyResolvePass"));
+        graph.addWrite(historyResolvePass, history);
+
+        graph.renumber(graph.buildExecutionOrder());
+        for (size_t node : graph.buildExecutionOrder()) {
+            std::cout << graph.getNode(node)->name << " -> ";
+        }
+        std::cout << std::endl << std::endl;
+    }
+
+    {
+        // Shadow cascade subgraph, compiled once and stamped once per light
+        TRWDependencyGraph<std::shared_ptr<SObject>, SResource, TKahnTopologicalSort> shadowGraph;
+
+        const SResource geometry{3};
+        const SResource shadowMap{100};
+
+        size_t shadowDepthPass = shadowGraph.addNode(std::make_shared<SObject>("shadowDepthPass"));
+        shadowGraph.addRead(shadowDepthPass, geometry);
+        shadowGraph.addWrite(shadowDepthPass, shadowMap);
+
+        size_t shadowBlurPass = shadowGraph.addNode(std::make_shared<SObject>("shadowBlurPass"));
+        shadowGraph.addRead(shadowBlurPass, shadowMap);
+        shadowGraph.addWrite(shadowBlurPass, shadowMap);
+
+        size_t shadowFilterPass = shadowGraph.addNode(std::make_shared<SObject>("shadowFilterPass"));
+        shadowGraph.addRead(shadowFilterPass, shadowMap);
+        shadowGraph.addWrite(shadowFilterPass, shadowMap);
+
+        const auto shadowTemplate = TRWGraphTemplate<std::shared_ptr<SObject>, SResource>::compile(shadowGraph);
+
+        TRWDependencyGraph<std::shared_ptr<SObject>, SResource, TKahnTopologicalSort> graph;
+
+        size_t geometryPass = graph.addNode(std::make_shared<SObject>("geometryPass"));
+        graph.addWrite(geometryPass, geometry);
+
+        std::vector<size_t> lights;
+        for (size_t light = 0; light < 4; ++light) {
+            lights.push_back(shadowTemplate.instantiate(graph, [&](const SResource& resource) {
+                return resource == shadowMap ? SResource{shadowMap.id + light} : resource;
+            }));
+        }
+
+        size_t lightingPass = graph.addNode(std::make_shared<SObject>("lightingPass"));
+        for (size_t light = 0; light < lights.size(); ++light)
+            graph.addRead(lightingPass, SResource{shadowMap.id + light});
+
+        const auto order = graph.buildExecutionOrder();
+
+        for (const auto& node : order) {
+            std::cout << graph.getNode(node)->name << " -> ";
+        }
+        std::cout << std::endl;
+
+        // Every access of the instances is stored, hazards computed from them match declaring the passes one by one
+        TRWDependencyGraph<std::shared_ptr<SObject>, SResource, TKahnTopologicalSort> declared;
+        for (size_t node = 0; node < graph.size(); ++node) {
+            declared.addNode(graph.getNode(node));
+            const auto accesses = graph.dependencies.find(node);
+            if (accesses == graph.dependencies.end())
+                continue;
+
+            for (const auto& access : accesses->second) {
+                if (access.type == decltype(graph)::Access::WRITE)
+                    declared.addWrite(node, access.node);
+                else
+                    declared.addRead(node, access.node);
+            }
+        }
+
+        const auto instancedEdges = graph.compile();
+        const auto declaredEdges = declared.compile();
+        if (instancedEdges.offsets != declaredEdges.offsets || instancedEdges.targets != declaredEdges.targets)
+            throw std::runtime_error("Instanced edges differ from declared ones!");
+        std::cout << graph.computeHazards().size() << " hazards instanced, " << declared.computeHazards().size() << " declared, same edges" << std::endl << std::endl;
+    }
+
+    {
+        // 64 instances of a 40 pass template against declaring the same passes, instancing copies the inner edges in bulk
+        // and only analyzes the accesses on the boundary of each resource
+        TRWDependencyGraph<size_t, SResource, TKahnTopologicalSort> lightGraph;
+
+        uint32_t seed = 3;
+        const auto random = [&seed] { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+
+        for (size_t node = 0; node < 40; ++node) {
+            lightGraph.addNode(node);
+            for (size_t access = 0; access < 3; ++access)
+                lightGraph.addRead(node, SResource{random() % 12});
+            lightGraph.addWrite(node, SResource{random() % 12});
+        }
+
+        const auto lightTemplate = TRWGraphTemplate<size_t, SResource>::compile(lightGraph);
+        const auto remap = [](const SResource& resource, const size_t light) { return SResource{resource.id + 100 * light}; };
+
+        int64_t instancedTime = INT64_MAX, declaredTime = INT64_MAX;
+        TCompiledGraph instancedEdges, declaredEdges;
+        for (size_t run = 0; run < 3; ++run) {
+            auto start = high_resolution_clock::now();
+            TRWDependencyGraph<size_t, SResource, TKahnTopologicalSort> instanced;
+            for (size_t light = 0; light < 64; ++light)
+                lightTemplate.instantiate(instanced, [&](const SResource& resource) { return remap(resource, light); });
+            instancedTime = std::min<int64_t>(instancedTime, duration_cast<microseconds>(high_resolution_clock::now() - start).count());
+
+            start = high_resolution_clock::now();
+            TRWDependencyGraph<size_t, SResource, TKahnTopologicalSort> declared;
+            for (size_t light = 0; light < 64; ++light) {
+                for (size_t node = 0; node < lightGraph.size(); ++node) {
+                    const size_t pass = declared.addNode(node);
+                    for (const auto& access : lightGraph.dependencies.find(node)->second) {
+                        if (access.type == decltype(declared)::Access::WRITE)
+                            declared.addWrite(pass, remap(access.node, light));
+                        else
+                            declared.addRead(pass, remap(access.node, light));
+                    }
+                }
+            }
+            declaredTime = std::min<int64_t>(declaredTime, duration_cast<microseconds>(high_resolution_clock::now() - start).count());
+
+            instancedEdges = instanced.compile();
+            declaredEdges = declared.compile();
+            // The template has no explicit dependencies, so neither have its instances, its hazards stay hazards for lints
+            if (!instanced.getExplicitDependencies().empty())
+                throw std::runtime_error("Instancing added explicit dependencies!");
+        }
+
+        if (instancedEdges.offsets != declaredEdges.offsets || instancedEdges.targets != declaredEdges.targets)
+            throw std::runtime_error("Instancing changed the edges!");
+        if (instancedTime >= declaredTime)
+            throw std::runtime_error("Instancing was not cheaper than declaring!");
+        std::cout << "64 instances of 40 passes, " << instancedEdges.edgeCount() << " edges, instanced " << instancedTime << "us, declared " << declaredTime << "us" << std::endl << std::endl;
+    }
+
+    {
+        // Post processing is compiled on its own and used as a single node of the frame
+        TSimpleDependencyGraph<TNestedNode<std::string>, TKahnTopologicalSort> postGraph;
+
+        size_t bloomPass = postGraph.addNode(std::string("bloomPass"));
+        size_t exposurePass = postGraph.addNode(std::string("exposurePass"));
+        size_t tonemapPass = postGraph.addNode(std::string("tonemapPass"));
+        postGraph.addDependency(bloomPass, tonemapPass);
+        postGraph.addDependency(exposurePass, tonemapPass);
+
+        const auto postSubgraph = TNestedGraph<std::string>::compile(postGraph);
+
+        TSimpleDependencyGraph<TNestedNode<std::string>, TKahnTopologicalSort> graph;
+
+        size_t scenePass = graph.addNode(std::string("scenePass"));
+        size_t postProcess = graph.addNode(postSubgraph);
+        size_t presentPass = graph.addNode(std::string("presentPass"));
+        graph.addDependency(scenePass, postProcess);
+        graph.addDependency(postProcess, presentPass);
+
+        for (const auto& node : graph.buildExecutionOrder()) {
+            std::cout << (graph.getNode(node).isSubgraph() ? std::string("postProcess") : graph.getNode(node).value) << " -> ";
+        }
+        std::cout << std::endl;
+
+        const auto expanded = TNestedGraph<std::string>::compile(graph)->expand();
+        for (const auto& node : TKahnTopologicalSort{}(expanded.graph)) {
+            std::cout << expanded.nodes[node] << " -> ";
+        }
+        std::cout << std::endl << std::endl;
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    {
+        // A wide graph split over 4 processes, every pass checks that its inputs already ran
+        TSimpleDependencyGraph<size_t, TKahnTopologicalSort> graph;
+
+        for (size_t node = 0; node < 256; ++node) {
+            graph.addNode(node);
+            if (node >= 16)
+                graph.addDependency(node - 16, node);
+            if (node >= 16 && node % 5 == 0)
+                graph.addDependency(node - 13, node);
+        }
+
+        const auto compiled = graph.compile();
+        const auto partition = TGraphPartitioner{}(compiled, 4);
+
+        // Shared between the processes, so each one can see what the others finished
+        auto* finished = static_cast<volatile char*>(::mmap(nullptr, compiled.size(), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+
+        const bool succeeded = TProcessRunner<>{}(compiled, partition, [&](const size_t node) {
+            for (size_t predecessor : compiled.predecessors(node))
+                if (!finished[predecessor])
+                    throw std::runtime_error("Ran before its dependencies!");
+            finished[node] = 1;
+        });
+
+        std::cout << "Partitioned run over " << partition.costs.size() << " processes with " << partition.cutEdges << " of " << compiled.edgeCount() << " edges cut: " << (succeeded ? "succeeded" : "failed") << std::endl << std::endl;
+
+        ::munmap(const_cast<char*>(finished), compiled.size());
+    }
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+    {
+        // The same kind of graph, stored once in shared memory and run by 4 cooperating processes
+        TSimpleDependencyGraph<size_t, TKahnTopologicalSort> graph;
+
+        for (size_t node = 0; node < 256; ++node) {
+            graph.addNode(node);
+            if (node >= 8)
+                graph.addDependency(node - 8, node);
+        }
+
+        const auto compiled = graph.compile();
+        const std::string name = "/SimpleDG-Test-" + std::to_string(::getpid());
+        TSharedGraph shared = TSharedGraph::create(name, compiled);
+
+        auto* finished = static_cast<volatile char*>(::mmap(nullptr, compiled.size(), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+
+        const auto execute = [&](const size_t node) {
+            for (size_t predecessor : compiled.predecessors(node))
+                if (!finished[predecessor])
+                    throw std::runtime_error("Ran before its dependencies!");
+            finished[node] = 1;
+        };
+
+        std::cout.flush();
+        std::vector<pid_t> workers;
+        for (size_t worker = 0; worker < 3; ++worker) {
+            const pid_t child = ::fork();
+            if (child == 0) {
+                int status = 0;
+                try {
+                    TSharedGraph::open(name).run(execute);
+                } catch (...) {
+                    status = 1;
+                }
+                ::_exit(status);
+            }
+            workers.push_back(child);
+        }
+
+        bool succeeded = true;
+        try {
+            shared.run(execute);
+        } catch (...) {
+            succeeded = false;
+        }
+        for (pid_t worker : workers) {
+            int status = 0;
+            ::waitpid(worker, &status, 0);
+            succeeded = succeeded && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+
+        std::cout << "Shared memory run over " << workers.size() + 1 << " processes: " << (succeeded ? "succeeded" : "failed") << std::endl;
+
+        ::munmap(const_cast<char*>(finished), compiled.size());
+
+        // A cycle is rejected before anything is shared
+        TSimpleDependencyGraph<size_t, TKahnTopologicalSort> cyclic;
+        cyclic.addNode(0);
+        cyclic.addNode(1);
+        cyclic.addDependency(0, 1);
+        cyclic.addDependency(1, 0);
+        try {
+            TSharedGraph::create(name + "-Cyclic", cyclic.compile());
+        } catch (const std::runtime_error& error) {
+            std::cout << error.what() << std::endl;
+        }
+
+        // A worker that dies mid-node never releases its successors, the others give up once nothing finishes for a while
+        TSimpleDependencyGraph<size_t, TKahnTopologicalSort> chain;
+        chain.addNode(0);
+        chain.addNode(1);
+        chain.addDependency(0, 1);
+        TSharedGraph stalled = TSharedGraph::create(name + "-Stalled", chain.compile());
+
+        const pid_t crashing = ::fork();
+        if (crashing == 0) {
+            TSharedGraph::open(name + "-Stalled").run([](size_t) { ::_exit(3); });
+            ::_exit(0);
+        }
+        int status = 0;
+        ::waitpid(crashing, &status, 0);
+        try {
+            stalled.run([](size_t) {}, milliseconds(100));
+            throw std::logic_error("Waited on a dead worker without noticing!");
+        } catch (const std::runtime_error& error) {
+            std::cout << error.what() << std::endl;
+        }
+
+        // A segment shorter than its header claims is rejected before any of its counts is used
+        const int file = ::shm_open((name + "-Stalled").c_str(), O_RDWR, 0600);
+        if (file < 0 || ::ftruncate(file, 128) != 0)
+            throw std::runtime_error("Could not truncate the shared graph!");
+        ::close(file);
+        try {
+            TSharedGraph::open(name + "-Stalled");
+            throw std::logic_error("Opened a truncated shared graph!");
+        } catch (const std::runtime_error& error) {
+            std::cout << error.what() << std::endl;
+        }
+        std::cout << std::endl;
+    }
+#endif
+
+    {
+        // Each subsystem records its passes on its own thread, the sequence keys decide the merged order
+        TRWDependencyGraph<std::shared_ptr<SObject>, SResource, TKahnTopologicalSort> graph;
+
+        const SResource sceneColor{0};
+        std::vector<TGraphRecorder<std::shared_ptr<SObject>, SResource>> recorders(4);
+        std::vector<std::thread> threads;
+
+        for (size_t subsystem = 0; subsystem < recorders.size(); ++subsystem) {
+            threads.emplace_back([&, subsystem] {
+                auto& recorder = recorders[subsystem];
+                for (uint64_t pass = 0; pass < 2; ++pass) {
+                    const size_t node = recorder.addNode(pass * recorders.size() + subsystem, std::make_shared<SObject>("subsystem" + std::to_string(subsystem) + "Pass" + std::to_string(pass)));
+                    recorder.addRead(node, sceneColor);
+                    recorder.addWrite(node, sceneColor);
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        std::vector<TGraphRecorder<std::shared_ptr<SObject>, SResource>*> merged;
+        for (auto& recorder : recorders)
+            merged.push_back(&recorder);
+        TGraphRecorder<std::shared_ptr<SObject>, SResource>::merge(graph, merged);
+
+        for (const auto& node : graph.buildExecutionOrder()) {
+            std::cout << graph.getNode(node)->name << " -> ";
+        }
+        std::cout << std::endl << std::endl;
+    }
+
+    {
+        // Large random graph, hazards analyzed incrementally and then split over 4 threads
+        TRWDependencyGraph<size_t, SResource, TKahnTopologicalSort> graph;
+
+        uint32_t seed = 1;
+        const auto random = [&seed] { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+
+        for (size_t node = 0; node < 50000; ++node) {
+            graph.addNode(node);
+            for (size_t access = 0; access < 4; ++access) {
+                if (random() % 3 == 0)
+                    graph.addWrite(node, SResource{random() % 2000});
+                else
+                    graph.addRead(node, SResource{random() % 2000});
+            }
+        }
+
+        // Hazards were resolved and kept as sorted edge lists while the accesses were added, so this only copies them into CSR
+        auto start = high_resolution_clock::now();
+        const auto incremental = graph.compile();
+        const auto incrementalTime = duration_cast<milliseconds>(high_resolution_clock::now() - start).count();
+
+        // Threads drop the incremental state, so back on one thread compiling analyzes every access again
+        graph.setHazardThreads(4);
+        graph.setHazardThreads(1);
+        start = high_resolution_clock::now();
+        const auto serial = graph.compile();
+        const auto serialTime = duration_cast<milliseconds>(high_resolution_clock::now() - start).count();
+
+        graph.setHazardThreads(4);
+        start = high_resolution_clock::now();
+        const auto parallel = graph.compile();
+        const auto parallelTime = duration_cast<milliseconds>(high_resolution_clock::now() - start).count();
+
+        if (serial.offsets != parallel.offsets || serial.targets != parallel.targets || serial.offsets != incremental.offsets || serial.targets != incremental.targets)
+            throw std::runtime_error("Threaded hazard analysis differs from the serial one!");
+        std::cout << "Hazard analysis of " << serial.edgeCount() << " edges, serial " << serialTime << "ms, 4 threads " << parallelTime << "ms, "
+                  << "incremental " << incrementalTime << "ms, identical" << std::endl << std::endl;
+    }
+
+    {
+        // Editor graph that loses a pass, the tombstone is skipped until the graph is compacted
+        TRWDependencyGraph<std::shared_ptr<SObject>, SResource, TKahnTopologicalSort> graph;
+
+        const SResource hdrColor{0};
+
+        size_t scenePass = graph.addNode(std::make_shared<SObject>("scenePass"));
+        graph.addWrite(scenePass, hdrColor);
+
+        size_t debugPass = graph.addNode(std::make_shared<SObject>("debugPass"));
+        graph.addRead(debugPass, hdrColor);
+        graph.addWrite(debugPass, hdrColor);
+
+        size_t presentPass = graph.addNode(std::make_shared<SObject>("presentPass"));
+        graph.addRead(presentPass, hdrColor);
+
+        const TNodeHandle debugHandle = graph.getHandle(debugPass);
+        const TNodeHandle presentHandle = graph.getHandle(presentPass);
+        graph.removeNode(debugHandle);
+
+        for (const auto& node : graph.buildExecutionOrder()) {
+            std::cout << graph.getNode(node)->name << " -> ";
+        }
+        std::cout << std::endl;
+
+        const auto remap = graph.compact();
+        std::cout << "After compacting " << graph.size() << " nodes, stale handles: " << !graph.isValid(debugHandle) << " " << !graph.isValid(presentHandle)
+            << ", presentPass is now " << graph.getNode(remap[presentPass])->name << std::endl;
+
+        for (const auto& node : graph.buildExecutionOrder()) {
+            std::cout << graph.getNode(node)->name << " -> ";
+        }
+        std::cout << std::endl << std::endl;
+    }
+
+    {
+        // A sorter that only takes the adjacency map still works, and never sees the removed pass
+        TSimpleDependencyGraph<std::string, SAdjacencySort> graph;
+
+        size_t scenePass = graph.addNode("scenePass");
+        size_t debugPass = graph.addNode("debugPass");
+        size_t presentPass = graph.addNode("presentPass");
+        graph.addDependency(scenePass, debugPass);
+        graph.addDependency(debugPass, presentPass);
+        graph.addDependency(scenePass, presentPass);
+        graph.removeNode(graph.getHandle(debugPass));
+
+        for (const auto& node : graph.buildExecutionOrder()) {
+            std::cout << graph.getNode(node) << " -> ";
+        }
+        std::cout << std::endl << std::endl;
+    }
+
+    {
+        // Passes declared out of order, renumbered so ids follow the level order they run in
+        TSimpleDependencyGraph<std::string, TKahnTopologicalSort> graph;
+
+        size_t presentPass = graph.addNode("presentPass");
+        size_t tonemapPass = graph.addNode("tonemapPass");
+        size_t shadowPass = graph.addNode("shadowPass");
+        size_t scenePass = graph.addNode("scenePass");
+        graph.addDependency(scenePass, tonemapPass);
+        graph.addDependency(shadowPass, tonemapPass);
+        graph.addDependency(tonemapPass, presentPass);
+
+        const auto remap = graph.renumber(TLevelTopologicalSort{}(graph.compile()));
+
+        for (size_t node = 0; node < graph.size(); ++node) {
+            std::cout << node << ": " << graph.getNode(node) << " ";
+        }
+        std::cout << "(presentPass " << presentPass << " -> " << remap[presentPass] << ")" << std::endl << std::endl;
+    }
+
+    {
+        // Mostly local edges, renumbered into level order and compressed, sorting reads the varints directly
+        TSimpleDependencyGraph<size_t, TKahnTopologicalSort> graph;
+
+        uint32_t seed = 1;
+        const auto random = [&seed] { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+
+        for (size_t node = 0; node < 100000; ++node)
+            graph.addNode(node);
+        for (size_t node = 0; node + 64 < 100000; ++node)
+            for (size_t edge = 0; edge < 8; ++edge)
+                graph.addDependency(node, node + 1 + random() % 64);
+
+        graph.renumber(TLevelTopologicalSort{}(graph.compile()));
+        const auto compiled = graph.compile();
+        const auto compressed = TCompressedGraph::compress(compiled);
+
+        const size_t compiledBytes = (compiled.offsets.size() + compiled.targets.size() + compiled.inDegree.size()) * sizeof(size_t);
+        const bool identical = TKahnTopologicalSort{}(compiled) == TKahnTopologicalSort{}(compressed);
+        std::cout << compiled.edgeCount() << " edges compressed from " << compiledBytes / 1024 << "KB to " << compressed.memoryUsage() / 1024 << "KB: " << (identical ? "identical order" : "different order") << std::endl << std::endl;
+    }
+
+    {
+        // Only what the shadow output needs, extracted from the whole frame
+        TSimpleDependencyGraph<std::string, TKahnTopologicalSort> graph;
+
+        size_t cullPass = graph.addNode("cullPass");
+        size_t shadowPass = graph.addNode("shadowPass");
+        size_t scenePass = graph.addNode("scenePass");
+        size_t uiPass = graph.addNode("uiPass");
+        size_t presentPass = graph.addNode("presentPass");
+        graph.addDependency(cullPass, shadowPass);
+        graph.addDependency(cullPass, scenePass);
+        graph.addDependency(shadowPass, scenePass);
+        graph.addDependency(scenePass, presentPass);
+        graph.addDependency(uiPass, presentPass);
+
+        std::vector<size_t> originalIds;
+        const auto slice = graph.compile().extractSubgraph({shadowPass}, originalIds);
+
+        for (const auto& node : TKahnTopologicalSort{}(slice)) {
+            std::cout << graph.getNode(originalIds[node]) << " -> ";
+        }
+        std::cout << std::endl;
+
+        const auto consumers = graph.compile().extractSubgraph({shadowPass}, originalIds, TCompiledGraph::DESCENDANTS);
+
+        for (const auto& node : TKahnTopologicalSort{}(consumers)) {
+            std::cout << graph.getNode(originalIds[node]) << " -> ";
+        }
+        std::cout << std::endl;
+
+        std::vector<size_t> ranks;
+        graph.buildExecutionOrder(ranks);
+        std::cout << "uiPass runs " << (ranks[uiPass] < ranks[scenePass] ? "before" : "after") << " scenePass" << std::endl << std::endl;
+    }
+
+    {
+        // An external scheduler with two lanes pulls nodes as they become ready and completes them out of order
+        TSimpleDependencyGraph<std::string, TKahnTopologicalSort> graph;
+
+        size_t uploadPass = graph.addNode("uploadPass");
+        size_t skinningPass = graph.addNode("skinningPass");
+        size_t particlesPass = graph.addNode("particlesPass");
+        size_t scenePass = graph.addNode("scenePass");
+        graph.addDependency(uploadPass, skinningPass);
+        graph.addDependency(uploadPass, particlesPass);
+        graph.addDependency(skinningPass, scenePass);
+        graph.addDependency(particlesPass, scenePass);
+
+        const auto compiled = graph.compile();
+        TReadySet<> readySet(compiled);
+
+        std::vector<size_t> lanes;
+        while (!readySet.finished()) {
+            size_t node;
+            while (lanes.size() < 2 && readySet.next(node)) {
+                std::cout << "start " << graph.getNode(node) << ", ";
+                lanes.push_back(node);
+            }
+
+            std::cout << "complete " << graph.getNode(lanes.back()) << ", ";
+            readySet.markComplete(lanes.back());
+            lanes.pop_back();
+        }
+        std::cout << std::endl << std::endl;
+    }
+
+    {
+        // Each cascade is only needed by the matching lighting pass, ASAP renders them all up front
+        TRWDependencyGraph<std::shared_ptr<SObject>, SResource, TKahnTopologicalSort> graph;
+
+        const SResource hdrColor{0};
+
+        size_t clearPass = graph.addNode(std::make_shared<SObject>("clearPass"));
+        graph.addWrite(clearPass, hdrColor);
+
+        for (size_t cascade = 0; cascade < 3; ++cascade) {
+            const SResource shadowMap{10 + cascade};
+
+            size_t shadowPass = graph.addNode(std::make_shared<SObject>("shadowPass" + std::to_string(cascade)));
+            graph.addWrite(shadowPass, shadowMap);
+
+            size_t lightPass = graph.addNode(std::make_shared<SObject>("lightPass" + std::to_string(cascade)));
+            graph.addRead(lightPass, shadowMap);
+            graph.addRead(lightPass, hdrColor);
+            graph.addWrite(lightPass, hdrColor);
+        }
+
+        const auto comparison = compareSchedules(graph);
+
+        for (const auto& node : comparison.alapOrder) {
+            std::cout << graph.getNode(node)->name << " -> ";
+        }
+        std::cout << std::endl << "Peak live resources, ASAP: " << comparison.asapPeakLiveResources << ", ALAP: " << comparison.alapPeakLiveResources << std::endl;
+
+        const auto affinity = TResourceAffinitySort{}(graph);
+
+        for (const auto& node : affinity.order) {
+            std::cout << graph.getNode(node)->name << " -> ";
+        }
+        std::cout << std::endl << "Resource switches, Kahn: " << TResourceUsage::build(graph).countResourceSwitches(comparison.asapOrder) << ", affinity: " << affinity.resourceSwitches << std::endl;
+
+        // Offline search, shadow maps are large and the result is cached as text
+        TScheduleOptimizer optimizer;
+        const auto schedule = optimizer(graph, [](size_t) { return 1.0; }, [](const SResource& resource) { return resource.id >= 10 ? 4.0 : 1.0; });
+
+        std::stringstream cache;
+        schedule.serialize(cache);
+        const auto loaded = TOptimizedSchedule::deserialize(cache);
+
+        for (const auto& node : loaded.order) {
+            std::cout << graph.getNode(node)->name << " -> ";
+        }
+        std::cout << std::endl << "Optimized peak memory " << loaded.cost.peakMemory << ", barriers " << loaded.cost.barriers << ", makespan " << loaded.cost.makespan
+            << (loaded.isValid(graph.compile()) ? ", valid" : ", invalid") << std::endl << std::endl;
+    }
+
+    {
+        // The same frame built twice, the second time with a different bloom pass
+        const auto buildFrame = [](TRWDependencyGraph<std::shared_ptr<SObject>, SResource, TKahnTopologicalSort>& graph, const std::string& bloomName) {
+            const SResource hdrColor{0};
+            const SResource depth{1};
+            const SResource bloom{4};
+
+            size_t gbufferPass = graph.addNode(std::make_shared<SObject>("gbufferPass"));
+            graph.addWrite(gbufferPass, hdrColor);
+            graph.addWrite(gbufferPass, depth);
+
+            size_t lightingPass = graph.addNode(std::make_shared<SObject>("lightingPass"));
+            graph.addRead(lightingPass, depth);
+            graph.addRead(lightingPass, hdrColor);
+            graph.addWrite(lightingPass, hdrColor);
+
+            size_t bloomPass = graph.addNode(std::make_shared<SObject>(bloomName));
+            graph.addRead(bloomPass, hdrColor);
+            graph.addWrite(bloomPass, bloom);
+
+            size_t compositePass = graph.addNode(std::make_shared<SObject>("compositePass"));
+            graph.addRead(compositePass, bloom);
+            graph.addRead(compositePass, hdrColor);
+            graph.addWrite(compositePass, hdrColor);
+        };
+
+        TRWDependencyGraph<std::shared_ptr<SObject>, SResource, TKahnTopologicalSort> previous, current;
+        buildFrame(previous, "bloomPass");
+        buildFrame(current, "fastBloomPass");
+
+        const auto hashName = [](const std::shared_ptr<SObject>& object) { return std::hash<std::string>{}(object->name); };
+        const auto previousHashes = TStructuralHashes::compute(previous, hashName);
+        const auto currentHashes = TStructuralHashes::compute(current, hashName);
+
+        for (size_t node = 0; node < current.size(); ++node) {
+            std::cout << current.getNode(node)->name << (previousHashes.nodes[node] == currentHashes.nodes[node] ? " reused, " : " changed, ");
+        }
+        std::cout << std::endl << std::endl;
+    }
+
+    {
+        // A frame where the bloom pass is dropped and a debug overlay is drawn instead
+        using TGraph = TRWDependencyGraph<std::shared_ptr<SObject>, SResource, TKahnTopologicalSort>;
+        const SResource hdrColor{0};
+        const SResource depth{1};
+        const SResource bloom{4};
+
+        TGraph previous, current;
+        for (TGraph* graph : {&previous, &current}) {
+            size_t gbufferPass = graph->addNode(std::make_shared<SObject>("gbufferPass"));
+            graph->addWrite(gbufferPass, hdrColor);
+            graph->addWrite(gbufferPass, depth);
+
+            if (graph == &previous) {
+                size_t bloomPass = graph->addNode(std::make_shared<SObject>("bloomPass"));
+                graph->addRead(bloomPass, hdrColor);
+                graph->addWrite(bloomPass, bloom);
+            } else {
+                size_t debugPass = graph->addNode(std::make_shared<SObject>("debugPass"));
+                graph->addRead(debugPass, depth);
+                graph->addWrite(debugPass, hdrColor);
+            }
+
+            size_t compositePass = graph->addNode(std::make_shared<SObject>("compositePass"));
+            graph->addRead(compositePass, hdrColor);
+            graph->addWrite(compositePass, hdrColor);
+        }
+
+        const auto hashName = [](const std::shared_ptr<SObject>& object) { return std::hash<std::string>{}(object->name); };
+        const auto diff = TRWGraphDiff<SResource>::compute(previous, current, hashName);
+
+        for (size_t node : diff.addedNodes)
+            std::cout << "added " << current.getNode(node)->name << ", ";
+        for (size_t node : diff.removedNodes)
+            std::cout << "removed " << previous.getNode(node)->name << ", ";
+        for (size_t node : diff.changedNodes)
+            std::cout << "changed " << current.getNode(node)->name << ", ";
+        std::cout << std::endl;
+
+        const char* hazardNames[] = {"RAW", "WAR", "WAW"};
+        for (const auto& hazard : diff.addedHazards)
+            std::cout << "+" << hazardNames[hazard.type] << " " << current.getNode(hazard.from)->name << " -> " << current.getNode(hazard.to)->name << ", ";
+        for (const auto& hazard : diff.removedHazards)
+            std::cout << "-" << hazardNames[hazard.type] << " " << previous.getNode(hazard.from)->name << " -> " << previous.getNode(hazard.to)->name << ", ";
+        std::cout << std::endl << diff.addedEdges.size() << " edges added, " << diff.removedEdges.size() << " removed" << std::endl << std::endl;
+    }
+
+    {
+        // Two effect chains that were generated separately but do the same work on the same input
+        TSimpleDependencyGraph<std::string, TKahnTopologicalSort> graph;
+
+        size_t loadPass = graph.addNode("loadPass");
+        size_t blurPass = graph.addNode("blurPass");
+        size_t sharpenPass = graph.addNode("sharpenPass");
+        size_t otherBlurPass = graph.addNode("blurPass");
+        size_t otherSharpenPass = graph.addNode("sharpenPass");
+        size_t blendPass = graph.addNode("blendPass");
+        graph.addDependency(loadPass, blurPass);
+        graph.addDependency(blurPass, sharpenPass);
+        graph.addDependency(loadPass, otherBlurPass);
+        graph.addDependency(otherBlurPass, otherSharpenPass);
+        graph.addDependency(sharpenPass, blendPass);
+        graph.addDependency(otherSharpenPass, blendPass);
+
+        // A removed debug view of the second blur leaves an edge to its tombstone behind
+        size_t debugPass = graph.addNode("debugPass");
+        graph.addDependency(otherBlurPass, debugPass);
+        graph.removeNode(graph.getHandle(debugPass));
+
+        const auto deduplication = graph.mergeDuplicates(std::hash<std::string>{}, std::equal_to<std::string>{});
+
+        for (size_t node : graph.buildExecutionOrder()) {
+            std::cout << graph.getNode(node) << ", ";
+        }
+        std::cout << std::endl << deduplication.mergedCount << " duplicates merged" << std::endl << std::endl;
+    }
+
+    {
+        // Two independent blurs that share one scratch texture, so they end up running one after the other
+        TRWDependencyGraph<std::shared_ptr<SObject>, SResource, TKahnTopologicalSort> graph;
+        const SResource scratch{0};
+        const SResource bloom{1};
+        const SResource dof{2};
+
+        size_t bloomDownPass = graph.addNode(std::make_shared<SObject>("bloomDownPass"));
+        graph.addWrite(bloomDownPass, scratch);
+
+        size_t bloomUpPass = graph.addNode(std::make_shared<SObject>("bloomUpPass"));
+        graph.addRead(bloomUpPass, scratch);
+        graph.addWrite(bloomUpPass, bloom);
+
+        size_t dofDownPass = graph.addNode(std::make_shared<SObject>("dofDownPass"));
+        graph.addWrite(dofDownPass, scratch);
+
+        size_t dofUpPass = graph.addNode(std::make_shared<SObject>("dofUpPass"));
+        graph.addRead(dofUpPass, scratch);
+        graph.addWrite(dofUpPass, dof);
+
+        const char* kindNames[] = {"false hazard", "hot resource", "false only dependency"};
+        const auto print = [&](const TGraphLints<SResource>& lints) {
+            std::cout << "critical path " << lints.criticalPath << std::endl;
+            for (const auto& finding : lints.findings) {
+                std::cout << kindNames[finding.kind];
+                if (finding.from != SIZE_MAX)
+                    std::cout << " " << graph.getNode(finding.from)->name << " ->";
+                if (finding.to != SIZE_MAX)
+                    std::cout << " " << graph.getNode(finding.to)->name;
+                std::cout << " on resource " << finding.resources.front().id << ", gain " << (finding.exact ? "" : "at most ") << finding.criticalPathGain << std::endl;
+            }
+            std::cout << std::endl;
+        };
+        print(TGraphLints<SResource>::compute(graph));
+
+        // Without exact evaluations only the bounds from the surrounding chains are left
+        print(TGraphLints<SResource>::compute(graph, 0.25, 0));
+    }
+
+    {
+        // Frames of a blur chain, the half resolution targets are reused every frame and the quarter one is freed after two frames unused
+        TResourcePool<STextureDescriptor, size_t> pool(2);
+        size_t nextTexture = 0;
+        const auto allocate = [&](const STextureDescriptor&) { return nextTexture++; };
+        const auto release = [](size_t) {};
+
+        for (size_t frame = 0; frame < 5; ++frame) {
+            TRWDependencyGraph<std::shared_ptr<SObject>, SResource, TKahnTopologicalSort> graph;
+            const SResource color{0};
+            const SResource halfA{1};
+            const SResource halfB{2};
+            const SResource quarter{3};
+
+            size_t scenePass = graph.addNode(std::make_shared<SObject>("scenePass"));
+            graph.addWrite(scenePass, color);
+
+            size_t downPass = graph.addNode(std::make_shared<SObject>("downPass"));
+            graph.addRead(downPass, color);
+            graph.addWrite(downPass, halfA);
+
+            size_t blurPass = graph.addNode(std::make_shared<SObject>("blurPass"));
+            graph.addRead(blurPass, halfA);
+            graph.addWrite(blurPass, halfB);
+
+            // Only in the first frame, its target is not needed afterwards
+            if (frame == 0) {
+                size_t extraBlurPass = graph.addNode(std::make_shared<SObject>("extraBlurPass"));
+                graph.addRead(extraBlurPass, halfB);
+                graph.addWrite(extraBlurPass, quarter);
+            }
+
+            size_t compositePass = graph.addNode(std::make_shared<SObject>("compositePass"));
+            graph.addRead(compositePass, frame == 0 ? quarter : halfB);
+            graph.addWrite(compositePass, color);
+
+            const auto describe = [&](const SResource& resource) {
+                if (resource == color)
+                    return STextureDescriptor{1920, 1080};
+                return resource == quarter ? STextureDescriptor{480, 270} : STextureDescriptor{960, 540};
+            };
+            const auto bindings = pool.bind(graph, graph.buildExecutionOrder(), describe, allocate, release);
+
+            std::cout << "frame " << frame << ": " << bindings.size() << " resources on " << pool.size() << " textures, ";
+        }
+        std::cout << std::endl << pool.stats.allocations << " allocations, " << pool.stats.reuses << " reuses, " << pool.stats.evictions << " evictions" << std::endl << std::endl;
+    }
+
+    {
+        // SSAO and the particle simulation only depend on little, so they can move to an async compute lane
+        TRWDependencyGraph<std::shared_ptr<SObject>, SResource, TKahnTopologicalSort> graph;
+        const SResource depth{0};
+        const SResource hdrColor{1};
+        const SResource ao{2};
+        const SResource particles{3};
+
+        size_t depthPrepass = graph.addNode(std::make_shared<SObject>("depthPrepass"));
+        graph.addWrite(depthPrepass, depth);
+
+        size_t ssaoPass = graph.addNode(std::make_shared<SObject>("ssaoPass"));
+        graph.addRead(ssaoPass, depth);
+        graph.addWrite(ssaoPass, ao);
+
+        size_t particleSimPass = graph.addNode(std::make_shared<SObject>("particleSimPass"));
+        graph.addWrite(particleSimPass, particles);
+
+        size_t opaquePass = graph.addNode(std::make_shared<SObject>("opaquePass"));
+        graph.addRead(opaquePass, depth);
+        graph.addWrite(opaquePass, hdrColor);
+
+        size_t lightingPass = graph.addNode(std::make_shared<SObject>("lightingPass"));
+        graph.addRead(lightingPass, ao);
+        graph.addRead(lightingPass, hdrColor);
+        graph.addWrite(lightingPass, hdrColor);
+
+        size_t particleDrawPass = graph.addNode(std::make_shared<SObject>("particleDrawPass"));
+        graph.addRead(particleDrawPass, particles);
+        graph.addRead(particleDrawPass, depth);
+        graph.addWrite(particleDrawPass, hdrColor);
+
+        const auto compiled = graph.compile();
+        std::cout << "alongside ssaoPass: ";
+        for (size_t node : TAsyncOverlap::concurrentWith(compiled, ssaoPass)) {
+            std::cout << graph.getNode(node)->name << ", ";
+        }
+        std::cout << std::endl;
+
+        const auto lanes = TAsyncOverlap::assignLanes(compiled, 2);
+        for (size_t lane = 0; lane < lanes.lanes.size(); ++lane) {
+            std::cout << "lane " << lane << ": ";
+            for (size_t node : lanes.lanes[lane]) {
+                std::cout << graph.getNode(node)->name << " at " << lanes.start[node] << ", ";
+            }
+            std::cout << std::endl;
+        }
+        std::cout << "done at " << lanes.makespan << std::endl << std::endl;
+    }
+
     return 0;
 }
\ No newline at end of file